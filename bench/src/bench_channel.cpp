@@ -0,0 +1,113 @@
+#include <libchannel.hpp>
+#include <iostream>
+#include <exception>
+#include <bits/stdc++.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace LibResult;
+struct Reading {
+    int sensor;
+    double value;
+};
+enum class Fault : int {
+    none,
+    offline
+};
+
+// messages per second from a child process to this one through a ResultChannel
+// every 16th message is an Err, and every message has a trace of one frame behind it
+template<unsigned Depth> double run_channel(int messages) {
+    using namespace std;
+    using Channel = ResultChannel<Reading, Fault, Depth>;
+    string name = "/libresult_bench_" + to_string(getpid()) + "_" + to_string(Depth);
+    Result<Channel*, int>& created = Channel::create(name.c_str(), 1024);
+    Channel& receiver = *created.unwrap();
+    pid_t child = fork();
+    if (child == 0) {
+        Result<Channel*, int>& opened = Channel::open(name.c_str());
+        Channel& sender = *opened.unwrap();
+        Result<Reading, Fault>* ok = new Ok<Reading, Fault>(Reading{1, 0.5});
+        ok->push_back(Reading{1, 0.25});
+        Result<Reading, Fault>* err = new Err<Reading, Fault>(Fault::offline);
+        err->push_back(Reading{1, 0.25});
+        for (int i = 0; i < messages; i++) {
+            sender.send(i % 16 == 0 ? *err : *ok);
+        }
+        _exit(0);
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double sum = 0;
+    for (int i = 0; i < messages; i++) {
+        const typename Channel::Message& m = receiver.receive();
+        sum += m.is_ok() ? m.value().value : 0;
+        receiver.release();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    waitpid(child, nullptr, 0);
+    delete &receiver;
+    delete &created;
+    assert(sum > 0);
+    return messages / seconds;
+}
+
+// the same handoff re-serialized as text lines through a pipe
+double run_text(int messages) {
+    using namespace std;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return 0;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        FILE* out = fdopen(fds[1], "w");
+        for (int i = 0; i < messages; i++) {
+            if (i % 16 == 0) {
+                fprintf(out, "err %d\ntrace ok %d %.17g\n", static_cast<int>(Fault::offline), 1, 0.25);
+            } else {
+                fprintf(out, "ok %d %.17g\ntrace ok %d %.17g\n", 1, 0.5, 1, 0.25);
+            }
+        }
+        fclose(out);
+        _exit(0);
+    }
+    close(fds[1]);
+    FILE* in = fdopen(fds[0], "r");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double sum = 0;
+    char tag[8];
+    for (int i = 0; i < messages; i++) {
+        Reading r;
+        Reading t;
+        if (fscanf(in, "%7s", tag) != 1) {
+            break;
+        }
+        if (strcmp(tag, "ok") == 0) {
+            if (fscanf(in, "%d %lf", &r.sensor, &r.value) == 2) {
+                sum += r.value;
+            }
+        } else {
+            int code;
+            if (fscanf(in, "%d", &code) != 1) {
+                break;
+            }
+        }
+        if (fscanf(in, " trace ok %d %lf", &t.sensor, &t.value) != 2) {
+            break;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fclose(in);
+    waitpid(child, nullptr, 0);
+    assert(sum > 0);
+    return messages / seconds;
+}
+
+int main() {
+    using namespace std;
+    const int messages = 2000000;
+    cout << "Results handed from one process to another (" << messages << " messages)" << endl;
+    cout << setw(32) << left << "ResultChannel, no trace" << fixed << setprecision(0) << run_channel<0>(messages) << " msgs/s" << endl;
+    cout << setw(32) << left << "ResultChannel, 4 trace frames" << run_channel<4>(messages) << " msgs/s" << endl;
+    cout << setw(32) << left << "text lines through a pipe" << run_text(messages) << " msgs/s" << endl;
+}
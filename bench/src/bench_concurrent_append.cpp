@@ -0,0 +1,58 @@
+#include <libresult.hpp>
+#include <iostream>
+#include <exception>
+#include <bits/stdc++.h>
+using namespace LibResult;
+
+// appends per second from n threads into one shared trace,
+// either with push_back_concurrent() or with push_back() behind a mutex
+double run(int n, int appends, bool lock_free) {
+    using namespace std;
+    Result<int, exception>* head = new Ok<int, exception>(0);
+    // allocate every frame up front so that only the appends are timed
+    vector<vector<Result<int, exception>*>> frames(n);
+    for (int t = 0; t < n; t++) {
+        for (int i = 0; i < appends; i++) {
+            frames[t].push_back(new Ok<int, exception>(i));
+        }
+    }
+    mutex m;
+    // the workers wait for go, which is set once start has been taken, so every append is timed
+    atomic<bool> go(false);
+    vector<thread> threads;
+    head->begin_concurrent();
+    for (int t = 0; t < n; t++) {
+        threads.emplace_back([&, t] {
+            while (!go.load(memory_order_acquire)) {}
+            for (Result<int, exception>* r : frames[t]) {
+                if (lock_free) {
+                    head->push_back_concurrent(*r);
+                } else {
+                    lock_guard<mutex> lock(m);
+                    head->push_back(*r);
+                }
+            }
+        });
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    go.store(true, memory_order_release);
+    for (thread& t : threads) {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    delete head;
+    return n * appends / seconds;
+}
+
+int main() {
+    using namespace std;
+    const int appends = 200000;
+    int cores = max(1u, thread::hardware_concurrency());
+    cout << "contended appends into one trace (" << cores << " hardware threads)" << endl;
+    cout << setw(8) << "threads" << setw(18) << "lock-free/s" << setw(18) << "mutex/s" << endl;
+    for (int n = 1; n <= max(cores, 8); n *= 2) {
+        double lock_free = run(n, appends, true);
+        double locked = run(n, appends, false);
+        cout << setw(8) << n << setw(18) << fixed << setprecision(0) << lock_free << setw(18) << locked << endl;
+    }
+}
@@ -0,0 +1,56 @@
+#include <libresult.hpp>
+#include <iostream>
+#include <exception>
+#include <bits/stdc++.h>
+using namespace LibResult;
+
+// how each frame of the trace is pushed
+enum class Push {
+    // a new Ok per frame, as before value frames existed
+    ok,
+    // a new ValueFrame per frame, which is what push_back(const T&) does with LIBRESULT_INLINE_FRAMES = 0
+    frame,
+    // push_back(const T&), which keeps the first LIBRESULT_INLINE_FRAMES frames inside the head
+    value
+};
+
+// nanoseconds per Result built with a trace of depth frames, then dropped
+template<Push How> double run(int depth, int operations) {
+    using namespace std;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long sum = 0;
+    for (int i = 0; i < operations; i++) {
+        Result<int, exception>* r = new Ok<int, exception>(i);
+        for (int d = 0; d < depth; d++) {
+            if constexpr (How == Push::value) {
+                r->push_back(i + d);
+            } else if constexpr (How == Push::frame) {
+                r->push_back(*(new ValueFrame<int, exception>(i + d)));
+            } else {
+                r->push_back(*(new Ok<int, exception>(i + d)));
+            }
+        }
+        for (const ResultBase* f = r; f != nullptr; f = f->get_next()) {
+            sum += *f->value_if<int>();
+        }
+        delete r;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    assert(sum != 0);
+    return seconds * 1e9 / operations;
+}
+
+int main() {
+    using namespace std;
+    const int operations = 1000000;
+    cout << "Result<int, exception> with a trace, ns per Result (LIBRESULT_INLINE_FRAMES = " << LIBRESULT_INLINE_FRAMES << ")" << endl;
+    // the middle column isolates what the inline room buys from what value frames save over Oks
+    cout << setw(8) << left << "depth" << setw(16) << "push_back(Ok&)" << setw(24) << "INLINE_FRAMES = 0" << setw(16) << "push_back(T)" << endl;
+    cout << fixed << setprecision(1);
+    for (int depth : {1, 2, 4, 8}) {
+        double allocated = run<Push::ok>(depth, operations);
+        double frames = run<Push::frame>(depth, operations);
+        double inlined = run<Push::value>(depth, operations);
+        cout << setw(8) << depth << setw(16) << allocated << setw(24) << frames << inlined << " (" << frames / inlined << "x)" << endl;
+    }
+}
@@ -0,0 +1,53 @@
+#include <libresult.hpp>
+#include <iostream>
+#include <exception>
+#include <bits/stdc++.h>
+using namespace LibResult;
+
+// a pipeline stage that records its input and an intermediate value in the trace
+Result<int, std::exception>& stage(Result<int, std::exception>& a) {
+    int i = a.unwrap();
+    Result<int, std::exception>& b = i % 1024 == 1023
+        ? static_cast<Result<int, std::exception>&>(*(new Err<int, std::exception>(new std::domain_error("overflow"))))
+        : static_cast<Result<int, std::exception>&>(*(new Ok<int, std::exception>(i + 1)));
+    b.push_back(i * 2);
+    b.push_back(a);
+    return b;
+}
+
+// nanoseconds per operation of a four stage pipeline under the current Sampler configuration
+double run(int operations) {
+    using namespace std;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long sum = 0;
+    for (int i = 0; i < operations; i++) {
+        Sampler::begin();
+        Result<int, exception>* r = new Ok<int, exception>(i);
+        for (int s = 0; s < 4 && r->is_ok(); s++) {
+            r = &stage(*r);
+        }
+        sum += r->is_ok();
+        delete r;
+    }
+    Sampler::end();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    assert(sum > 0);
+    return seconds * 1e9 / operations;
+}
+
+int main() {
+    using namespace std;
+    const int operations = 1000000;
+    cout << "four stage pipeline, ns per operation" << endl;
+    Sampler::all();
+    cout << setw(36) << left << "every operation traced" << fixed << setprecision(1) << run(operations) << endl;
+    Sampler::every(100);
+    cout << setw(36) << left << "1 in 100 traced" << run(operations) << endl;
+    Sampler::per_second(1000, 10);
+    cout << setw(36) << left << "token bucket, 1000/s" << run(operations) << endl;
+    Sampler::every(1000000);
+    Sampler::force_errors(1);
+    cout << setw(36) << left << "none traced, Errs forced" << run(operations) << endl;
+    Sampler::force_errors(0);
+    Sampler::all();
+}
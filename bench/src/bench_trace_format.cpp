@@ -0,0 +1,64 @@
+#include <libresult.hpp>
+#include <libexception.hpp>
+#include <libtrace.hpp>
+#include <iostream>
+#include <bits/stdc++.h>
+using namespace LibResult;
+using LibException::Exception;
+
+// microseconds per rendering of the trace behind head, averaged over rounds
+template<class F> double time_rounds(int rounds, F render) {
+    using namespace std;
+    size_t total = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        total += render();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    assert(total > 0);
+    return seconds * 1e6 / rounds;
+}
+
+int main() {
+    using namespace std;
+    const int frames = 10000;
+    const int rounds = 200;
+    Result<float, Exception>* head = new Ok<float, Exception>(0.5f);
+    mt19937 random(7);
+    uniform_real_distribution<float> values(-1e6f, 1e6f);
+    for (int i = 1; i < frames; i++) {
+        head->push_back(values(random));
+    }
+    // every frame written with "<<" into an ostream, as get_trace() did before TraceSink
+    double iostream_us = time_rounds(rounds, [head] {
+        ostringstream os;
+        for (const ResultBase* f = head; f != nullptr; f = f->get_next()) {
+            os << *f->value_if<float>() << '\n';
+        }
+        return os.str().size();
+    });
+    // to_chars into the thread's buffer, copied out as a string
+    double string_us = time_rounds(rounds, [head] {
+        return LibTrace::to_string(*head).size();
+    });
+    // to_chars into the thread's buffer, then one write to an ostream
+    double stream_us = time_rounds(rounds, [head] {
+        ostringstream os;
+        LibTrace::get_trace(*head, os);
+        return os.str().size();
+    });
+    // to_chars into the thread's buffer only
+    double buffer_us = time_rounds(rounds, [head] {
+        ThreadBufferSink sink;
+        head->get_trace(sink);
+        return sink.size();
+    });
+    assert(LibTrace::to_string(*head).size() > 0);
+    cout << "rendering a " << frames << " frame Result<float, Exception> trace, us per trace" << endl;
+    cout << fixed << setprecision(1);
+    cout << setw(44) << left << "operator<< into an ostringstream" << iostream_us << endl;
+    cout << setw(44) << left << "LibTrace::get_trace() to an ostringstream" << stream_us << " (" << iostream_us / stream_us << "x)" << endl;
+    cout << setw(44) << left << "LibTrace::to_string()" << string_us << " (" << iostream_us / string_us << "x)" << endl;
+    cout << setw(44) << left << "get_trace(ThreadBufferSink&)" << buffer_us << " (" << iostream_us / buffer_us << "x)" << endl;
+    delete head;
+}
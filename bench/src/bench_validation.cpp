@@ -0,0 +1,106 @@
+#include <libvalidated.hpp>
+#include <iostream>
+#include <bits/stdc++.h>
+using namespace LibResult;
+
+enum class FieldError {
+    out_of_range
+};
+
+const int fields = 40;
+
+// an independent check of one field, in the style of a pipeline stage
+Result<int, FieldError>& check_field(int v) {
+    if (v < 0 || v > 1000) {
+        return *new Err<int, FieldError>(FieldError::out_of_range);
+    }
+    return *new Ok<int, FieldError>(v);
+}
+
+// a record with bad fields spread evenly over its 40 fields
+std::array<int, fields> make_record(int bad) {
+    std::array<int, fields> record;
+    for (int i = 0; i < fields; i++) {
+        record[i] = i * 7;
+    }
+    for (int b = 0; b < bad; b++) {
+        record[b * fields / bad] = -1;
+    }
+    return record;
+}
+
+// every error of a record found with fail-fast Results: each pass stops at the first error not reported yet,
+// so k errors take k + 1 passes over the record
+int fail_fast(const std::array<int, fields>& record) {
+    std::array<bool, fields> reported{};
+    int errors = 0;
+    for (;;) {
+        bool clean = true;
+        for (int i = 0; i < fields; i++) {
+            Result<int, FieldError>& r = check_field(record[i]);
+            bool failed = r.is_err() && !reported[i];
+            delete &r;
+            if (failed) {
+                reported[i] = true;
+                errors++;
+                clean = false;
+                break;
+            }
+        }
+        if (clean) {
+            return errors;
+        }
+    }
+}
+
+// every error of a record in one pass, absorbing each field's Result into a Validated
+int validated(const std::array<int, fields>& record) {
+    Validated<std::array<int, fields>, FieldError> v(std::array<int, fields>{});
+    v.reserve(fields);
+    for (int i = 0; i < fields; i++) {
+        if (std::optional<int> x = v.check(check_field(record[i]))) {
+            v.get()[i] = *x;
+        }
+    }
+    return static_cast<int>(v.error_count());
+}
+
+// every error of a record in one pass with plain checks, without a Result per field
+int ensured(const std::array<int, fields>& record) {
+    Validated<std::array<int, fields>, FieldError> v(record);
+    v.reserve(fields);
+    for (int i = 0; i < fields; i++) {
+        v.ensure(record[i] >= 0 && record[i] <= 1000, FieldError::out_of_range);
+    }
+    return static_cast<int>(v.error_count());
+}
+
+// nanoseconds per record validated by f
+template<class F> double run(F f, const std::array<int, fields>& record, int bad, int rounds) {
+    using namespace std;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long found = 0;
+    for (int i = 0; i < rounds; i++) {
+        found += f(record);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    assert(found == static_cast<long long>(bad) * rounds);
+    return seconds * 1e9 / rounds;
+}
+
+int main() {
+    using namespace std;
+    const int rounds = 100000;
+    cout << "finding every error of a " << fields << " field record, ns per record" << endl;
+    cout << setw(12) << left << "bad fields" << setw(24) << "fail-fast passes" << setw(24) << "Validated::check()" << "Validated::ensure()" << endl;
+    cout << fixed << setprecision(1);
+    for (int bad : {0, 1, 4, 10, 40}) {
+        array<int, fields> record = make_record(bad);
+        double passes = run(fail_fast, record, bad, rounds);
+        double checked = run(validated, record, bad, rounds);
+        double plain = run(ensured, record, bad, rounds);
+        stringstream speedup;
+        speedup << fixed << setprecision(1) << checked << " (" << passes / checked << "x)";
+        cout << setw(12) << bad << setw(24) << passes << setw(24) << speedup.str() << plain << " (" << passes / plain << "x)" << endl;
+    }
+}
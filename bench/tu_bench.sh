@@ -0,0 +1,91 @@
+#!/bin/sh
+# compares a synthetic program of many translation units that use Results
+# built against the I/O-free core header with the same program that also includes <iostream>
+# (which is what every user of libresult.hpp paid for before the trace formatting moved to libtrace)
+# reports compile time, binary size, static initializers and startup time
+# usage: bench/tu_bench.sh [translation units] (run from the repository root after make libs)
+set -e
+TUS=${1:-200}
+CXX=${CXX:-g++}
+CXX_FLAGS=${CXX_FLAGS:-"-std=c++20 -I include -pthread"}
+BENCH_FLAGS=${BENCH_FLAGS:-"-O2"}
+RUNS=${RUNS:-200}
+DIR=bench/tu
+
+generate() {
+    variant=$1
+    mkdir -p $DIR/$variant/src $DIR/$variant/obj
+    i=0
+    while [ $i -lt $TUS ]; do
+        {
+            if [ $variant = iostream ]; then
+                echo "#include <iostream>"
+            fi
+            echo "#include <libresult.hpp>"
+            echo "#include <exception>"
+            echo "using namespace LibResult;"
+            echo "Result<int, std::exception>& stage_$i(Result<int, std::exception>& a) {"
+            echo "    Result<int, std::exception>& b = a.is_ok()"
+            echo "        ? static_cast<Result<int, std::exception>&>(*(new Ok<int, std::exception>(a.unwrap() + $i)))"
+            echo "        : static_cast<Result<int, std::exception>&>(*(new Err<int, std::exception>(std::exception())));"
+            echo "    b.push_back(a);"
+            echo "    return b;"
+            echo "}"
+        } > $DIR/$variant/src/tu_$i.cpp
+        i=$((i + 1))
+    done
+    {
+        echo "#include <libresult.hpp>"
+        echo "#include <exception>"
+        echo "using namespace LibResult;"
+        i=0
+        while [ $i -lt $TUS ]; do
+            echo "Result<int, std::exception>& stage_$i(Result<int, std::exception>&);"
+            i=$((i + 1))
+        done
+        echo "int main() {"
+        echo "    Result<int, std::exception>* r = new Ok<int, std::exception>(0);"
+        i=0
+        while [ $i -lt $TUS ]; do
+            echo "    r = &stage_$i(*r);"
+            i=$((i + 1))
+        done
+        echo "    int v = r->unwrap();"
+        echo "    delete r;"
+        echo "    return v == 0;"
+        echo "}"
+    } > $DIR/$variant/src/main.cpp
+}
+
+now() {
+    date +%s.%N
+}
+
+measure() {
+    variant=$1
+    generate $variant
+    start=$(now)
+    for src in $DIR/$variant/src/*.cpp; do
+        $CXX $CXX_FLAGS $BENCH_FLAGS -c $src -o $DIR/$variant/obj/$(basename $src .cpp).o
+    done
+    end=$(now)
+    $CXX $CXX_FLAGS $BENCH_FLAGS $DIR/$variant/obj/*.o lib/libresult.so -o $DIR/$variant/program
+    compile=$(awk "BEGIN { print $end - $start }")
+    text=$(size $DIR/$variant/program | awk 'NR == 2 { print $1 + $2 + $3 }')
+    file=$(stat -c %s $DIR/$variant/program)
+    inits=$(nm $DIR/$variant/program | grep -c "_GLOBAL__sub_I" || true)
+    start=$(now)
+    i=0
+    while [ $i -lt $RUNS ]; do
+        ./$DIR/$variant/program
+        i=$((i + 1))
+    done
+    end=$(now)
+    startup=$(awk "BEGIN { printf \"%d\", ($end - $start) * 1000000 / $RUNS }")
+    printf "%-9s %4d TUs: compile %8.2f s, text+data+bss %9d B, file %9d B, static initializers %4d, run %6d us\n" \
+        $variant $TUS $compile $text $file $inits $startup
+}
+
+measure core
+measure iostream
+rm -rf $DIR
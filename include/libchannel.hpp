@@ -0,0 +1,382 @@
+#ifndef LIBCHANNEL_HPP
+#define LIBCHANNEL_HPP
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <libresult.hpp>
+
+namespace LibResult {
+    // a named POSIX shared-memory segment mapped into this process
+    class SharedSegment {
+        std::string name;
+        void* base = nullptr;
+        std::size_t size = 0;
+        bool owner = false;
+      public:
+        SharedSegment() = default;
+        SharedSegment(const SharedSegment&) = delete;
+        SharedSegment& operator=(const SharedSegment&) = delete;
+
+        // creates a zero-filled segment called name of n bytes and maps it
+        // pre-conditions:
+            // name is a valid cstring of the form "/name"
+            // nothing is mapped by this yet
+        // post-conditions:
+            // if 0 has been returned, the segment exists, is mapped and is owned by this
+            // else, errno of the failing call has been returned and nothing is mapped
+        int create(const char* name, std::size_t n);
+
+        // maps the existing segment called name
+        // pre-conditions:
+            // name is a valid cstring of the form "/name"
+            // nothing is mapped by this yet
+        // post-conditions:
+            // if 0 has been returned, the whole segment is mapped
+            // else, errno of the failing call has been returned and nothing is mapped
+        int open(const char* name);
+
+        // returns the address the segment is mapped at
+        void* data() const {
+            return base;
+        }
+
+        // returns the size of the mapped segment in bytes
+        std::size_t length() const {
+            return size;
+        }
+
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the segment has been unmapped
+            // if this created it, its name has been unlinked (processes that mapped it keep their mapping)
+        ~SharedSegment();
+    };
+
+    // a single-producer/single-consumer ring of Results in a POSIX shared-memory segment,
+    // so that the stages of a pipeline can run in separate local processes without serializing text
+    // T and E (an error code such as an enum) are copied into the slots as raw bytes, and
+    // each message carries up to TraceDepth frames of the trace behind it; TraceDepth may be 0
+    // the receiver reads messages in place, without copying them out of the segment
+    template<class T, class E, unsigned TraceDepth = 4> class ResultChannel {
+        static_assert(std::is_trivially_copyable_v<T>, "ResultChannel needs a trivially copyable T");
+        static_assert(std::is_trivially_copyable_v<E>, "ResultChannel needs a trivially copyable E (an error code)");
+      public:
+        // one frame of a message: the type of the Result it was taken from, and its T or E if it held one
+        class Frame {
+            friend class ResultChannel;
+            LibTypeId::TypeId type;
+            bool err;
+            bool has_payload;
+            alignas(T) alignas(E) unsigned char payload[sizeof(T) > sizeof(E) ? sizeof(T) : sizeof(E)];
+
+            // copies the type and, when it is a T or E, the value of r
+            void store(const ResultBase& r) {
+                err = r.is_err();
+                type = err ? r.error_type() : r.value_type();
+                has_payload = false;
+                if (const T* t = r.value_if<T>()) {
+                    memcpy(payload, t, sizeof(T));
+                    has_payload = true;
+                } else if (const E* e = r.error_if<E>()) {
+                    memcpy(payload, e, sizeof(E));
+                    has_payload = true;
+                }
+            }
+          public:
+            bool is_ok() const {
+                return !err;
+            }
+
+            bool is_err() const {
+                return err;
+            }
+
+            // returns the id of the T (if Ok) or E (if Err) of the Result this frame was taken from
+            LibTypeId::TypeId get_type() const {
+                return type;
+            }
+
+            // returns the T in the segment if this frame was an Ok<T, *>, else nullptr
+            const T* value_if() const {
+                if (!has_payload || err) {
+                    return nullptr;
+                }
+                return std::launder(reinterpret_cast<const T*>(payload));
+            }
+
+            // returns the E in the segment if this frame was an Err<*, E>, else nullptr
+            const E* error_if() const {
+                if (!has_payload || !err) {
+                    return nullptr;
+                }
+                return std::launder(reinterpret_cast<const E*>(payload));
+            }
+        };
+
+        // a received Result, read in place in the segment
+        // it remains valid until release() is called
+        class Message {
+            friend class ResultChannel;
+            Frame head;
+            unsigned depth;
+            Frame frames[TraceDepth == 0 ? 1 : TraceDepth];
+          public:
+            bool is_ok() const {
+                return head.is_ok();
+            }
+
+            bool is_err() const {
+                return head.is_err();
+            }
+
+            // returns the held T
+            // pre-conditions:
+                // is_ok()
+            // post-conditions:
+                // a reference to the T in the segment has been returned
+            const T& value() const {
+                return *head.value_if();
+            }
+
+            // returns the held E
+            // pre-conditions:
+                // is_err()
+            // post-conditions:
+                // a reference to the E in the segment has been returned
+            const E& error() const {
+                return *head.error_if();
+            }
+
+            // returns the number of trace frames carried after the head
+            unsigned trace_size() const {
+                return depth;
+            }
+
+            // returns the i-th trace frame after the head
+            // pre-conditions:
+                // i < trace_size()
+            // post-conditions:
+                // the frame has been returned
+            const Frame& trace(unsigned i) const {
+                return frames[i];
+            }
+
+            // copies the message out of the segment into a new Result
+            // pre-conditions:
+                // none
+            // post-conditions:
+                // a new-allocated Ok or Err has been returned and is owned by the caller
+                // its trace holds the carried frames that were Results of T or E, in order
+            Result<T, E>& to_result() const {
+                Result<T, E>& r = is_ok()
+                    ? static_cast<Result<T, E>&>(*(new Ok<T, E>(value())))
+                    : static_cast<Result<T, E>&>(*(new Err<T, E>(error())));
+                for (unsigned i = 0; i < depth; i++) {
+                    if (const T* t = frames[i].value_if()) {
+                        r.push_back(*t);
+                    } else if (const E* e = frames[i].error_if()) {
+                        r.push_back(*e);
+                    }
+                }
+                return r;
+            }
+        };
+      private:
+        // identifies the segment layout, so a channel cannot be opened with other types
+        struct Layout {
+            std::uint64_t magic;
+            std::uint64_t slot_size;
+            LibTypeId::TypeId value_type;
+            LibTypeId::TypeId error_type;
+            std::uint32_t trace_depth;
+            std::uint64_t capacity;
+
+            bool matches(const Layout& other) const {
+                return magic == other.magic && slot_size == other.slot_size && value_type == other.value_type
+                    && error_type == other.error_type && trace_depth == other.trace_depth && capacity == other.capacity;
+            }
+        };
+
+        static constexpr std::uint64_t magic = 0x4c6962526573436eull;
+
+        // the start of the segment; the indices sit on their own cache lines so that
+        // the producer and consumer only share a line when one has to look at the other's index
+        struct Control {
+            Layout layout;
+            // set last by the creator, so an opener never sees a half-initialized layout
+            std::atomic<std::uint64_t> ready;
+            alignas(64) std::atomic<std::uint64_t> written;
+            alignas(64) std::atomic<std::uint64_t> read;
+        };
+
+        SharedSegment segment;
+        Control* control = nullptr;
+        Message* slots = nullptr;
+        std::uint64_t mask = 0;
+        // the last value seen of the other side's index, so it is only reloaded when the ring looks full or empty
+        std::uint64_t cached_read = 0;
+        std::uint64_t cached_written = 0;
+
+        static Layout expected_layout(std::uint64_t capacity) {
+            return Layout{magic, sizeof(Message), LibTypeId::type_id<T>, LibTypeId::type_id<E>, TraceDepth, capacity};
+        }
+
+        void attach() {
+            control = static_cast<Control*>(segment.data());
+            slots = reinterpret_cast<Message*>(static_cast<unsigned char*>(segment.data()) + sizeof(Control));
+            mask = control->layout.capacity - 1;
+            cached_read = control->read.load(std::memory_order_acquire);
+            cached_written = control->written.load(std::memory_order_acquire);
+        }
+
+        ResultChannel() = default;
+      public:
+        ResultChannel(const ResultChannel&) = delete;
+        ResultChannel& operator=(const ResultChannel&) = delete;
+
+        // creates the segment called name with room for capacity messages
+        // pre-conditions:
+            // name is a valid cstring of the form "/name" that is not in use
+            // capacity > 0
+        // post-conditions:
+            // on success, an Ok holding a new-allocated channel has been returned; the caller owns both
+            // the capacity has been rounded up to a power of two
+            // the segment is unlinked when the returned channel is deleted
+            // on failure, an Err holding the errno of the failing call has been returned
+        static Result<ResultChannel*, int>& create(const char* name, std::size_t capacity) {
+            std::uint64_t rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            ResultChannel* channel = new ResultChannel();
+            int error = channel->segment.create(name, sizeof(Control) + rounded * sizeof(Message));
+            if (error != 0) {
+                delete channel;
+                return *(new Err<ResultChannel*, int>(error));
+            }
+            Control* c = static_cast<Control*>(channel->segment.data());
+            c->layout = expected_layout(rounded);
+            c->written.store(0, std::memory_order_relaxed);
+            c->read.store(0, std::memory_order_relaxed);
+            c->ready.store(magic, std::memory_order_release);
+            channel->attach();
+            return *(new Ok<ResultChannel*, int>(channel));
+        }
+
+        // opens the segment called name, which another process created with the same T, E and TraceDepth
+        // pre-conditions:
+            // name is a valid cstring of the form "/name"
+        // post-conditions:
+            // on success, an Ok holding a new-allocated channel has been returned; the caller owns both
+            // on failure, an Err holding an errno has been returned:
+                // EAGAIN if the creator has not finished initializing the segment
+                // EPROTO if the segment was created for other types or another trace depth
+        static Result<ResultChannel*, int>& open(const char* name) {
+            ResultChannel* channel = new ResultChannel();
+            int error = channel->segment.open(name);
+            if (error == 0 && channel->segment.length() < sizeof(Control)) {
+                error = EPROTO;
+            }
+            if (error == 0) {
+                Control* c = static_cast<Control*>(channel->segment.data());
+                if (c->ready.load(std::memory_order_acquire) != magic) {
+                    error = EAGAIN;
+                } else {
+                    Layout l = expected_layout(c->layout.capacity);
+                    if (!l.matches(c->layout) || l.capacity == 0 || (l.capacity & (l.capacity - 1)) != 0
+                        || channel->segment.length() < sizeof(Control) + l.capacity * sizeof(Message)) {
+                        error = EPROTO;
+                    }
+                }
+            }
+            if (error != 0) {
+                delete channel;
+                return *(new Err<ResultChannel*, int>(error));
+            }
+            channel->attach();
+            return *(new Ok<ResultChannel*, int>(channel));
+        }
+
+        // returns the number of messages the ring holds
+        std::size_t capacity() const {
+            return mask + 1;
+        }
+
+        // copies r, and up to TraceDepth frames of its trace, into the next free slot
+        // only one process or thread may send on a channel
+        // pre-conditions:
+            // r is a constructed Ok or Err
+        // post-conditions:
+            // if the ring was full, false has been returned and nothing was sent
+            // else, the message has been published to the receiver and true has been returned
+        bool try_send(const Result<T, E>& r) {
+            std::uint64_t index = control->written.load(std::memory_order_relaxed);
+            if (index - cached_read > mask) {
+                cached_read = control->read.load(std::memory_order_acquire);
+                if (index - cached_read > mask) {
+                    return false;
+                }
+            }
+            Message& slot = slots[index & mask];
+            slot.head.store(r);
+            unsigned depth = 0;
+            for (const ResultBase* frame = r.get_next(); frame != nullptr && depth < TraceDepth; frame = frame->get_next()) {
+                slot.frames[depth++].store(*frame);
+            }
+            slot.depth = depth;
+            control->written.store(index + 1, std::memory_order_release);
+            return true;
+        }
+
+        // the same as try_send() but waits, yielding the processor, while the ring is full
+        void send(const Result<T, E>& r) {
+            while (!try_send(r)) {
+                std::this_thread::yield();
+            }
+        }
+
+        // returns the oldest unreleased message, read in place
+        // only one process or thread may receive on a channel
+        // pre-conditions:
+            // the previous message returned has been released
+        // post-conditions:
+            // if the ring was empty, nullptr has been returned
+            // else, a pointer to the message in the segment has been returned; it is valid until release()
+        const Message* try_receive() {
+            std::uint64_t index = control->read.load(std::memory_order_relaxed);
+            if (index == cached_written) {
+                cached_written = control->written.load(std::memory_order_acquire);
+                if (index == cached_written) {
+                    return nullptr;
+                }
+            }
+            return &slots[index & mask];
+        }
+
+        // the same as try_receive() but waits, yielding the processor, while the ring is empty
+        const Message& receive() {
+            const Message* m;
+            while ((m = try_receive()) == nullptr) {
+                std::this_thread::yield();
+            }
+            return *m;
+        }
+
+        // hands the slot of the message last returned by receive() back to the sender
+        // pre-conditions:
+            // a message has been received and not released
+        // post-conditions:
+            // the message may be overwritten and must no longer be used
+        void release() {
+            control->read.store(control->read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    };
+}
+#endif
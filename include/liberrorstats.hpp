@@ -0,0 +1,53 @@
+#ifndef LIBERRORSTATS_HPP
+#define LIBERRORSTATS_HPP
+#include <libresult.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// reading and reporting the per-site error counts that Errs record, kept apart from libresult.hpp
+// so that code which only creates and checks Results does not parse what reporting needs
+namespace LibResult {
+    // process-wide counts of Errs per error site, keyed by (E type id, E::where())
+    // counting is off until enable() is called; each thread counts into its own shard,
+    // so recording never contends with other threads
+    class ErrorStats : public ErrorRecorder {
+      public:
+        // one error site in a snapshot
+        struct Row {
+            LibTypeId::TypeId type;
+            std::string location;
+            // E::what() of the first error seen at this site
+            std::string description;
+            // Errs constructed since the last reset
+            std::uint64_t count;
+            // Errs per second since the previous snapshot
+            double rate;
+        };
+
+        // turns recording on or off
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // Errs constructed from now on are counted if on is true
+        static void enable(bool on = true) {
+            active.store(on, std::memory_order_relaxed);
+        }
+
+        // sums every thread's shard into one row per site
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the rows have been returned sorted by descending count, then type and location
+            // rates cover the time since the previous snapshot
+            // if reset is true, counts of later snapshots start again from zero
+        static std::vector<Row> snapshot(bool reset = false);
+
+        // formats rows as an aligned text table
+        static std::string table(const std::vector<Row>& rows);
+
+        // formats rows as a JSON array of objects
+        static std::string json(const std::vector<Row>& rows);
+    };
+}
+#endif
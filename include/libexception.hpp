@@ -1,54 +1,170 @@
+#ifndef LIBEXCEPTION_HPP
+#define LIBEXCEPTION_HPP
 #include <cstring>
 #include <exception>
+#include <libtypeid.hpp>
+
+// declares the type id of a class derived from LibException::Exception
+// place it in the body of every derived class that should be told apart by is<E2>() and match()
+// pre-conditions:
+    // Self derives publicly from Base, which is Exception or declares LIBEXCEPTION_TYPE itself
+// post-conditions:
+    // Self::type_id() returns the id of Self
+    // Self::is_a(id) is true for the ids of Self and of every declared base
+#define LIBEXCEPTION_TYPE(Self, Base) \
+  public: \
+    LibTypeId::TypeId type_id() const noexcept override { \
+        return LibTypeId::type_id<Self>; \
+    } \
+    bool is_a(LibTypeId::TypeId id) const noexcept override { \
+        return id == LibTypeId::type_id<Self> || Base::is_a(id); \
+    }
 
 namespace LibException {
+#ifdef LIBEXCEPTION_BACKTRACE
+#ifndef LIBEXCEPTION_BACKTRACE_DEPTH
+#define LIBEXCEPTION_BACKTRACE_DEPTH 16
+#endif
+    // a raw return-address stack captured into a fixed inline array without allocation
+    // symbols are only looked up when the backtrace is rendered
+    // LIBEXCEPTION_BACKTRACE must be defined consistently for the library and its users
+    class Backtrace {
+        void* frames[LIBEXCEPTION_BACKTRACE_DEPTH];
+        unsigned depth = 0;
+      public:
+        // captures the return addresses of the calling stack
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // up to LIBEXCEPTION_BACKTRACE_DEPTH addresses have been stored, innermost first
+            // the innermost skip frames (and capture() itself) have been left out
+            // nothing has been allocated
+        void capture(unsigned skip = 0) noexcept;
+
+        // returns the number of captured addresses
+        unsigned size() const {
+            return depth;
+        }
+
+        // returns the i-th captured address, innermost first
+        // pre-conditions:
+            // i < size()
+        // post-conditions:
+            // the i-th captured address has been returned
+        void* operator[](unsigned i) const {
+            return frames[i];
+        }
+
+        // returns a printable symbol for a code address
+        // pre-conditions:
+            // address is a return address from a captured stack
+        // post-conditions:
+            // "function+0xoffset" or "module(+0xoffset)" has been returned
+            // the result is cached process-wide and remains valid until exit
+        static const char* symbolize(void* address);
+
+        // writes one "\n    at <symbol>" line per captured address to sink
+        // this is the only renderer of backtraces: Err frames use it below what() in a trace
+        // pre-conditions:
+            // Sink has write(const char*), e.g. LibResult::TraceSink (LibTrace::OstreamSink for a std::ostream)
+        // post-conditions:
+            // each address has been symbolized (through the cache) and written to sink
+        template<class Sink> void render(Sink& sink) const {
+            for (unsigned i = 0; i < depth; i++) {
+                sink.write("\n    at ");
+                sink.write(symbolize(frames[i]));
+            }
+        }
+    };
+#endif
+
+#ifndef LIBEXCEPTION_INTERN_LIMIT
+#define LIBEXCEPTION_INTERN_LIMIT 16384
+#endif
+    // returns the process-wide canonical copy of the first n characters of s
+    // the table is read and extended without locks, and its strings are never freed, so it is meant for
+    // the small, fixed set of error locations; it holds at most LIBEXCEPTION_INTERN_LIMIT strings
+    // pre-conditions:
+        // s points to at least n readable characters
+    // post-conditions:
+        // a cstring equal to the argument has been returned, or nullptr if it is not in the table and the table is full
+        // equal arguments always return the same pointer, which remains valid until exit
+    const char* intern(const char* s, std::size_t n);
+
+    // returns the process-wide canonical copy of the cstring s
+    // pre-conditions:
+        // s is a valid cstring
+    // post-conditions:
+        // see intern(const char*, std::size_t)
+    inline const char* intern(const char* s) {
+        return intern(s, strlen(s));
+    }
+
     class Exception : std::exception {
       protected:
         const char* message = "Exception";
-        char* location = nullptr;
-        char* message_location = nullptr;
+        // interned so copies share it, unless the intern table is full
+        const char* location = nullptr;
+        // message + " in " + location, or message itself if location is ""
+        // interned like location, so equal messages share one string
+        const char* message_location = nullptr;
+        // a reference-counted block shared by copies, which holds the strings that could not be interned
+        // because the table was full; nullptr otherwise
+        struct Text;
+        Text* owned = nullptr;
+#ifdef LIBEXCEPTION_BACKTRACE
+        // the call stack where this was constructed
+        Backtrace backtrace;
+#endif
         
         // sets the location and message_location variables
         // pre-conditions:
             // l is a valid cstring
-            // this->location is delete[] safe
             // this->message is a valid cstring
-            // this->message_location is delete[] safe
         // post-conditions:
-            // l has been copied to this->location
-            // if location != "", then message_location holds: message + " in " + location
-            // else, message_location == message
+            // this->location points to the interned copy of l
+            // if location != "", then message_location points to the interned message + " in " + location
+            // else, message_location points to message
+            // if the intern table is full, the strings that could not be interned have been copied to this->owned instead
         void set_location(const char* l);
 
+        // drops this's reference to owned
+        // pre-conditions:
+            // owned is nullptr or a block this holds a reference to
+        // post-conditions:
+            // the block has been freed if this held the last reference, and owned is nullptr
+        void release() noexcept;
+
         // copy constructor
         // pre-conditions:
             // m and l are non-null ptrs 
+            // m remains valid for the lifetime of this (e.g. a string literal)
         // post-conditions:
-            // the contents of m has been copied to this->message
-            // the contents of l has been copied to this->location
+            // this->message points to m
+            // this->location points to the interned copy of l
         Exception(const char* m, const char* l);
       public:
         // default constructor
         // pre-conditions:
-            // this->location == nullptr or is otherwise delete[] safe
+            // none
         // post-conditions:
-            // "" has been copied to this->location
+            // this->location points to the interned ""
             // this->message is default
         Exception(); 
         
         // copy constructor
         // pre-conditions:
-            // other is constructed or otherwise has a non-null location
+            // other is constructed
         // post-conditions:
-            // the contents of other.location has been copied to this->location
-            // this->message is default
+            // the message, location and message_location pointers of other have been copied
+            // the block holding other's strings is shared
         Exception(const Exception& other);
         
         // copy constructor
         // pre-conditions:
             // l is a non-null ptr 
         // post-conditions
-            // the contents of l is copied to this->location
+            // this->location points to the interned copy of l
             // this->message is default
         Exception(const char* l);
         
@@ -69,19 +185,57 @@ namespace LibException {
             // the location has been returned
         const char* where() const;
 
+#ifdef LIBEXCEPTION_BACKTRACE
+        // returns the call stack captured when this (or the Exception it was copied from) was constructed
+        // pre-conditions:
+            // this has been constructed
+        // post-conditions:
+            // the captured backtrace has been returned
+        const Backtrace& get_backtrace() const;
+#endif
+
+        // returns the id of the most derived class that declares LIBEXCEPTION_TYPE
+        // pre-conditions:
+            // this has been constructed
+        // post-conditions:
+            // a compile-time id has been returned without RTTI
+        virtual LibTypeId::TypeId type_id() const noexcept {
+            return LibTypeId::type_id<Exception>;
+        }
+
+        // checks if this is an instance of the class with the given id or of a class derived from it
+        // pre-conditions:
+            // this has been constructed
+        // post-conditions:
+            // true has been returned if id names the dynamic class of this or one of its declared bases
+        virtual bool is_a(LibTypeId::TypeId id) const noexcept {
+            return id == LibTypeId::type_id<Exception>;
+        }
+
+        // checks if this is an E2 without RTTI
+        // pre-conditions:
+            // E2 is Exception or declares LIBEXCEPTION_TYPE
+        // post-conditions:
+            // true has been returned if this is an E2 or derived from E2
+        template<class E2> bool is() const noexcept {
+            return is_a(LibTypeId::type_id<E2>);
+        }
+
         // copy assignment
         // pre-conditions:
             // other is constructed and has a valid location and message
         // post-conditions:
-            // other.location has been copied to this->location
+            // the message, location and message_location pointers of other have been copied
+            // the block holding other's strings is shared, and the one of this released
+            // if LIBEXCEPTION_BACKTRACE is defined, other's backtrace has been copied to this
         Exception& operator=(const Exception& other);
 
         // pre-conditions:
-            // this->location is delete[] safe
-            // this->message_location is delete[] safe
+            // none
         // post-conditions:
-            // this->location is deleted
-            // this->message_location is deleted
+            // this has been destroyed, its block of strings freed if no copy shares it
+            // the interned strings are kept for other Exceptions
         virtual ~Exception(); 
     };
 }
+#endif
@@ -1,21 +1,522 @@
-#include <iostream>
-#include <stdexcept>
+#ifndef LIBRESULT_HPP
+#define LIBRESULT_HPP
 #include <utility>
 #include <memory>
+#include <new>
 #include <assert.h>
 #include <cstring>
 #include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <source_location>
+#include <tuple>
+#include <type_traits>
+#include <libtypeid.hpp>
+#ifdef LIBRESULT_TIMESTAMPS
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+// the number of LIBRESULT_TRY sites each Err keeps inside itself, one pointer each; further propagations are only counted
+#ifndef LIBRESULT_TRY_DEPTH
+#define LIBRESULT_TRY_DEPTH 4
+#endif
+// the number of value frames each Result keeps inside itself before allocating them (0 turns this off)
+// every Result pays for the room, frames included, so only the most common shallow trace is covered by default
+// it must be defined consistently for the libraries and their users
+#ifndef LIBRESULT_INLINE_FRAMES
+#define LIBRESULT_INLINE_FRAMES 1
+#endif
+// 1 if Err::unwrap() and Err::expect() throw the held E, 0 if they call the unwrap handler instead
+// (see set_unwrap_handler()), which is the default when exceptions are disabled with -fno-exceptions
+#ifndef LIBRESULT_EXCEPTIONS
+#ifdef __cpp_exceptions
+#define LIBRESULT_EXCEPTIONS 1
+#else
+#define LIBRESULT_EXCEPTIONS 0
+#endif
+#endif
+
+// evaluates expr, a Result<T, E>&, and returns early from the enclosing function if it is an Err
+// the Err itself is returned (converted with Err::into() if the function returns another Result<T2, E>&)
+// after recording the source location of the propagation, without allocating a new frame
+// otherwise the expression yields the Ok as a Result<T, E>&
+// pre-conditions:
+    // the enclosing function returns a Result<T2, E>& for the same E
+    // expr has been allocated with new, and the caller takes ownership of it as usual
+// post-conditions:
+    // on Err, the location has been appended to the Err's propagation sites and the Err has been returned
+    // on Ok, a reference to expr has been yielded
+#define LIBRESULT_TRY(expr) \
+    (*({ \
+        auto& libresult_try_result = (expr); \
+        if (__builtin_expect(libresult_try_result.is_err(), 0)) { \
+            return LibResult::propagate(libresult_try_result, std::source_location::current()); \
+        } \
+        &libresult_try_result; \
+    }))
+
 namespace LibResult {
     class ResultBase;
     template<class T, class E> class Result;
     template<class T, class E> class Ok;
     template<class T, class E> class Err;
+    template<class T, class E> class Validated;
+
+#ifdef LIBRESULT_TIMESTAMPS
+    // cheap monotonic clock used to timestamp trace frames
+    // LIBRESULT_TIMESTAMPS must be defined consistently for the library and its users
+    struct Clock {
+        // returns the current tick count
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the TSC has been returned where available, else steady_clock nanoseconds
+        static std::uint64_t ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        // returns the number of nanoseconds per tick
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the tick rate has been calibrated against steady_clock on the first call
+            // the calibrated ratio has been returned
+        static double ns_per_tick();
+
+        // converts a tick delta to nanoseconds
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the argument scaled by ns_per_tick() has been returned
+        static std::int64_t to_ns(std::int64_t t) {
+            return static_cast<std::int64_t>(t * ns_per_tick());
+        }
+    };
+#endif
+
+    // the destination of a rendered trace
+    // the core only writes text and numbers to it, so it needs no I/O headers (see libtrace.hpp for std::ostream)
+    class TraceSink {
+      public:
+        // writes n characters starting at s
+        // pre-conditions:
+            // s points to at least n readable characters
+        // post-conditions:
+            // the characters have been written in order
+        virtual void write(const char* s, std::size_t n) = 0;
+
+        // writes the cstring s
+        void write(const char* s) {
+            write(s, strlen(s));
+        }
+
+        // writes the decimal form of a number, as std::ostream does by default
+        // (so a double gets 6 significant digits), using std::to_chars without allocating or reading the locale
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the number has been formatted on the stack and written
+        void write(long long i);
+        void write(unsigned long long u);
+        void write(double d);
+
+        virtual ~TraceSink() = default;
+    };
+
+    // a TraceSink that writes into a fixed array, dropping whatever does not fit
+    template<std::size_t N> class ArraySink : public TraceSink {
+        char text[N] = {};
+        std::size_t length = 0;
+      public:
+        using TraceSink::write;
+
+        // appends as many of the n characters starting at s as fit
+        void write(const char* s, std::size_t n) override {
+            n = n < N - 1 - length ? n : N - 1 - length;
+            memcpy(text + length, s, n);
+            length += n;
+            text[length] = '\0';
+        }
+
+        // returns the written characters as a cstring
+        const char* c_str() const {
+            return text;
+        }
+    };
+
+    // a TraceSink that appends to a char buffer owned by the calling thread
+    // the buffer keeps its capacity, so rendering traces on a thread stops allocating once it has grown;
+    // sinks on one thread may nest, each one only sees (and on destruction removes) what it appended
+    class ThreadBufferSink : public TraceSink {
+        std::string& buffer;
+        std::size_t start;
+      public:
+        using TraceSink::write;
+
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // this appends to the end of the calling thread's buffer
+        ThreadBufferSink();
+        ThreadBufferSink(const ThreadBufferSink&) = delete;
+        ThreadBufferSink& operator=(const ThreadBufferSink&) = delete;
+
+        // appends n characters starting at s
+        void write(const char* s, std::size_t n) override {
+            buffer.append(s, n);
+        }
+
+        // returns the characters written to this
+        const char* data() const {
+            return buffer.data() + start;
+        }
+
+        // returns the number of characters written to this
+        std::size_t size() const {
+            return buffer.size() - start;
+        }
+
+        // pre-conditions:
+            // sinks created on this thread after this one have been destroyed
+        // post-conditions:
+            // the characters written to this have been removed from the thread's buffer
+        ~ThreadBufferSink();
+    };
+
+    // writes an X to a TraceSink; this is the customization point for printing Ok values in traces
+    // specialize it for types that should print something other than "<unprintable>"
+    // (LibTrace::StreamFormatter<X> reuses an existing "<<" operation)
+    // pre-conditions:
+        // x is constructed
+    // post-conditions:
+        // x has been written to sink without a trailing newline
+    template<class X, class = void> struct Formatter {
+        static void format(TraceSink& sink, const X&) {
+            sink.write("<unprintable>");
+        }
+    };
+    template<class X> struct Formatter<X, std::enable_if_t<std::is_integral_v<X> && std::is_signed_v<X>>> {
+        static void format(TraceSink& sink, const X& x) {
+            sink.write(static_cast<long long>(x));
+        }
+    };
+    template<class X> struct Formatter<X, std::enable_if_t<std::is_integral_v<X> && std::is_unsigned_v<X>>> {
+        static void format(TraceSink& sink, const X& x) {
+            sink.write(static_cast<unsigned long long>(x));
+        }
+    };
+    template<class X> struct Formatter<X, std::enable_if_t<std::is_floating_point_v<X>>> {
+        static void format(TraceSink& sink, const X& x) {
+            sink.write(static_cast<double>(x));
+        }
+    };
+    template<class X> struct Formatter<X, std::enable_if_t<std::is_enum_v<X>>> {
+        static void format(TraceSink& sink, const X& x) {
+            Formatter<std::underlying_type_t<X>>::format(sink, static_cast<std::underlying_type_t<X>>(x));
+        }
+    };
+    template<> struct Formatter<char> {
+        static void format(TraceSink& sink, const char& c) {
+            sink.write(&c, 1);
+        }
+    };
+    template<> struct Formatter<std::string> {
+        static void format(TraceSink& sink, const std::string& s) {
+            sink.write(s.data(), s.size());
+        }
+    };
+    template<> struct Formatter<std::string_view> {
+        static void format(TraceSink& sink, const std::string_view& s) {
+            sink.write(s.data(), s.size());
+        }
+    };
+    template<> struct Formatter<const char*> {
+        static void format(TraceSink& sink, const char* const& s) {
+            sink.write(s);
+        }
+    };
+    template<> struct Formatter<char*> {
+        static void format(TraceSink& sink, char* const& s) {
+            sink.write(s);
+        }
+    };
+
+    // detects whether X carries a backtrace (see LibException::Exception::get_backtrace())
+    template<class X, class = void> struct has_backtrace : std::false_type {};
+    template<class X> struct has_backtrace<X, std::void_t<
+        decltype(std::declval<const X&>().get_backtrace())>> : std::true_type {};
+
+    // detect the optional parts of an E that ErrorStats records
+    template<class X, class = void> struct has_type_id : std::false_type {};
+    template<class X> struct has_type_id<X, std::void_t<
+        decltype(std::declval<const X&>().type_id())>> : std::true_type {};
+    template<class X, class = void> struct has_where : std::false_type {};
+    template<class X> struct has_where<X, std::void_t<
+        decltype(std::declval<const X&>().where())>> : std::true_type {};
+    template<class X, class = void> struct has_what : std::false_type {};
+    template<class X> struct has_what<X, std::void_t<
+        decltype(std::declval<const X&>().what())>> : std::true_type {};
+
+    // an error handler for match(), selected when the held E is an X (see LibException::Exception::is())
+    template<class X, class F> struct Handler {
+        using type = X;
+        F f;
+    };
+
+    // creates a handler for errors of type X, or derived from X
+    // pre-conditions:
+        // f is callable with a const X&
+    // post-conditions:
+        // a Handler<X, F> holding f has been returned
+    template<class X, class F> Handler<X, std::decay_t<F>> on(F&& f) {
+        return Handler<X, std::decay_t<F>>{std::forward<F>(f)};
+    }
+
+    // the common result type of handlers Hs when called with their error types
+    template<class... Hs> using handler_result_t = std::common_type_t<
+        std::invoke_result_t<decltype(Hs::f)&, const typename Hs::type&>...>;
+
+    // selects and calls the handler of match() that fits the dynamic type of an error
+    template<class R, class E, class... Hs> struct Dispatcher {
+        using Handlers = std::tuple<Hs&...>;
+
+        // calls the I-th handler with e cast to that handler's type
+        template<std::size_t I> static R call(const E& e, Handlers& hs) {
+            auto& h = std::get<I>(hs);
+            using X = typename std::remove_reference_t<decltype(h)>::type;
+            return h.f(static_cast<const X&>(e));
+        }
+
+        // calls the first handler from the I-th on whose type id is id, else the first handler whose type is a base of e
+        // the ids of the handler types are constants, so each step is one compare and a direct call
+        template<std::size_t I> static R exact(const E& e, Handlers& hs, LibTypeId::TypeId id) {
+            if constexpr (I == sizeof...(Hs)) {
+                return base<0>(e, hs);
+            } else {
+                using X = typename std::tuple_element_t<I, std::tuple<Hs...>>::type;
+                if (id == LibTypeId::type_id<X>) {
+                    return call<I>(e, hs);
+                }
+                return exact<I + 1>(e, hs, id);
+            }
+        }
+
+        // calls the first handler from the I-th on whose type is a base of e, else returns R()
+        template<std::size_t I> static R base(const E& e, Handlers& hs) {
+            if constexpr (I == sizeof...(Hs)) {
+                return R();
+            } else {
+                using X = typename std::tuple_element_t<I, std::tuple<Hs...>>::type;
+                if (e.is_a(LibTypeId::type_id<X>)) {
+                    return call<I>(e, hs);
+                }
+                return base<I + 1>(e, hs);
+            }
+        }
+
+        // pre-conditions:
+            // E has type_id() and is_a() methods (see LibException::Exception)
+            // every handler returns a type convertible to R
+        // post-conditions:
+            // the first handler for the exact type id of e has been called
+            // otherwise the first handler whose type is a base of e has been called
+            // the handler's result has been returned, or R() if none matched
+        static R run(const E& e, Handlers& hs) {
+            return exact<0>(e, hs, e.type_id());
+        }
+    };
+
+    // the recording half of ErrorStats (see liberrorstats.hpp), which every new Err reports to
+    // counting is off until ErrorStats::enable() is called; each thread counts into its own shard,
+    // so recording never contends with other threads
+    class ErrorRecorder {
+      protected:
+        static inline std::atomic<bool> active{false};
+      public:
+        // checks if recording is on
+        static bool enabled() noexcept {
+            return active.load(std::memory_order_relaxed);
+        }
+
+        // counts one error at a site in the calling thread's shard
+        // pre-conditions:
+            // location and description are valid cstrings
+        // post-conditions:
+            // the counter for (type, location) in this thread's shard has been incremented
+            // the counter has been allocated if this thread had not seen the site before
+        static void record(LibTypeId::TypeId type, const char* location, const char* description);
+
+        // counts e under its dynamic type id and location when they are available
+        // pre-conditions:
+            // e is constructed
+        // post-conditions:
+            // if recording is on, e has been counted under (e.type_id() or the id of E, e.where() or "")
+        template<class E> static void record(const E& e) {
+            if (!enabled()) {
+                return;
+            }
+            LibTypeId::TypeId type = LibTypeId::type_id<E>;
+            const char* location = "";
+            const char* description = "";
+            if constexpr (has_type_id<E>::value) {
+                type = e.type_id();
+            }
+            if constexpr (has_where<E>::value) {
+                location = e.where();
+            }
+            if constexpr (has_what<E>::value) {
+                description = e.what();
+            }
+            record(type, location, description);
+        }
+    };
+
+    // decides, per thread, which operations collect trace frames
+    // call begin() at the head of a pipeline: until the next begin() or end() on the same thread,
+    // an unsampled operation allocates no trace frames (push_back() of a value is skipped and
+    // push_back() of a Result deletes it), at the cost of one branch on a thread-local flag
+    // by default every operation is sampled; the configuration is process-wide and the decisions are per thread
+    class Sampler {
+        // the decision for the operation running on this thread
+        static inline thread_local bool sampled = true;
+
+        // turns tracing on for the rest of an unsampled operation if force_errors() picks this Err
+        static void sample_error() noexcept;
+      public:
+        // samples every operation (the default)
+        static void all();
+
+        // samples the first of every n operations begun on each thread
+        // pre-conditions:
+            // n > 0
+        // post-conditions:
+            // from the next begin() on, 1 in n operations on each thread are sampled
+        static void every(std::uint32_t n);
+
+        // samples operations while a per-thread token bucket has a token
+        // pre-conditions:
+            // rate >= 0 and burst >= 1
+        // post-conditions:
+            // each thread's bucket starts full with burst tokens and refills at rate tokens per second
+            // from the next begin() on, an operation is sampled if it can take a token
+        static void per_second(double rate, double burst);
+
+        // makes 1 in n of the Errs created in unsampled operations on each thread turn tracing on
+        // for the rest of their operation, so failures are captured at a known rate; 0 turns this off
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the Err and the frames recorded after it are traced, frames dropped before it are not
+        static void force_errors(std::uint32_t n);
+
+        // decides whether the operation starting on this thread is sampled
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // the decision has been stored for this thread and returned
+        static bool begin();
+
+        // ends the operation on this thread; frames are collected again until the next begin()
+        static void end() noexcept {
+            sampled = true;
+        }
+
+        // checks if the operation running on this thread collects trace frames
+        static bool tracing() noexcept {
+            return sampled;
+        }
+
+        // called when an Err is created, to apply force_errors()
+        static void error() noexcept {
+            if (!sampled) {
+                sample_error();
+            }
+        }
+    };
+
+    // writes E::what() for e (or e itself with Formatter<E> if it has no what()),
+    // followed by its backtrace if E carries one
+    template<class E> void render_error(TraceSink& sink, const E& e) {
+        if constexpr (has_what<E>::value) {
+            sink.write(e.what());
+        } else {
+            Formatter<E>::format(sink, e);
+        }
+        if constexpr (has_backtrace<E>::value) {
+            e.get_backtrace().render(sink);
+        }
+    }
 
     // Base class that stores a generic pointer to the value passed to Result
+    // it is also the type-erased trace frame, so a trace may hold Results of any T and E
     class ResultBase {
         struct Impl;
         Impl* pimpl;
+#ifdef LIBRESULT_TIMESTAMPS
+        // the Clock::ticks() value taken when this was constructed
+        std::uint64_t stamp;
+#endif
+        // relinks the frames that live inside it
+        template<class T, class E> friend class Result;
       protected:
+        // the next frame in the trace
+        ResultBase* next;
+
+        // the last frame in the trace where this is the head, or a frame before it when frames have been
+        // linked after it through another trace that this is part of (see catch_up())
+        ResultBase* tail;
+
+        // true if this is an Err
+        const bool err;
+
+        // the number of frames right after this in the trace that live inside this (see LIBRESULT_INLINE_FRAMES)
+        std::uint8_t inline_frames = 0;
+
+        // constructs a frame that holds its value itself, without the generic pointer
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // this is a trace of one frame and nothing has been allocated
+        explicit ResultBase(bool is_err);
+
+        // returns the last frame that lives inside this, or this if there is none
+        ResultBase* last_inline() const {
+            ResultBase* last = const_cast<ResultBase*>(this);
+            for (unsigned i = 0; i < inline_frames; i++) {
+                last = last->next;
+            }
+            return last;
+        }
+
+        // moves the frames that live inside this to the heap, so that they can outlive this
+        // pre-conditions:
+            // this is constructed
+        // post-conditions:
+            // inline_frames == 0 and the trace holds the same values in the same order
+        virtual void spill() {}
+
+        // copies the timestamp of other
+        // pre-conditions:
+            // other is constructed
+        // post-conditions:
+            // if LIBRESULT_TIMESTAMPS is defined, other's timestamp has been copied to this
+        void copy_stamp(const ResultBase& other) {
+#ifdef LIBRESULT_TIMESTAMPS
+            stamp = other.stamp;
+#else
+            static_cast<void>(other);
+#endif
+        }
+
         // returns the generic pointer to the stored value
         // pre-conditions:
             // ResultBase has been constructed and 
@@ -30,37 +531,463 @@ namespace LibResult {
         // post-conditions:
             // the stored generic pointer has been set to v
         void set(void* const& v);
+
+        // moves tail to the last frame of the trace
+        // this is O(1) unless this has been pushed onto another trace whose head has since pushed more frames,
+        // which are then walked once
+        // pre-conditions:
+            // tail is a frame of the trace where this is the head
+        // post-conditions:
+            // tail->next == nullptr
+        void catch_up() {
+            while (tail->next != nullptr) {
+                tail = tail->next;
+            }
+        }
+
+        // links r and its trace to the tail
+        // pre-conditions:
+            // r has been allocated with new and is not part of another trace
+        // post-conditions:
+            // r has been linked after the last frame of the trace
+            // the tail of r's trace is the new tail
+        void link(ResultBase& r) {
+            catch_up();
+            tail->next = &r;
+            tail = r.tail;
+        }
+
+        // takes over the timestamp and trace of other (used when converting a frame to another type)
+        // pre-conditions:
+            // other is constructed and is not part of another trace
+        // post-conditions:
+            // other's trace has been moved onto the tail of this
+            // if LIBRESULT_TIMESTAMPS is defined, other's timestamp has been copied to this
+        void take_frame(ResultBase& other) {
+            copy_stamp(other);
+            take_trace(other);
+        }
+
+        // prints "throwing unwrapped Err <what>[: <note>]" to stdout (used by Err::unwrap() and Err::expect()),
+        // or "unwrapped Err <what>[: <note>]" if the Err is not thrown
+        // pre-conditions:
+            // what is a valid cstring, note is a valid cstring or nullptr
+        // post-conditions:
+            // the line has been printed to stdout and stdout has been flushed
+        static void report_unwrap(const char* what, const char* note, bool throwing);
+
+        // hands an unwrapped Err to the unwrap handler, in place of throwing its E (see set_unwrap_handler())
+        // pre-conditions:
+            // err is a constructed Err, note is a valid cstring or nullptr
+        // post-conditions:
+            // does not return: the handler has been called, and std::abort() if the handler returned
+        [[noreturn]] static void unwrap_failed(const ResultBase& err, const char* note);
       public:
         // copy constructor
         // pre-conditions:
             // v is a valid generic pointer to a T or E value
+            // is_err is true if v points to an E
         // post-conditions:
             // pimpl has been allocated
             // the stored generic pointer has been set to v
-        ResultBase(void* const& v);
+            // this is a trace of one frame
+        ResultBase(void* const& v, bool is_err);
+
+        // checks if this points to an Ok
+        // this reads a flag rather than calling a virtual so that checks on hot paths stay cheap
+        // pre-conditions:
+            // this must point to a constructed Ok or Err
+        // post-conditions:
+            // if Ok, then true has been returned
+            // else, false has been returned
+        bool is_ok() const {
+            return !err;
+        }
+
+        // checks if this points to an Err
+        // pre-conditions:
+            // this must point to a constructed Ok or Err
+        // post-conditions:
+            // if Err, then true has been returned
+            // else, false has been returned
+        bool is_err() const {
+            return err;
+        }
+
+        // returns the id of the T of the Result this frame was created as
+        virtual LibTypeId::TypeId value_type() const = 0;
+
+        // returns the id of the E of the Result this frame was created as
+        virtual LibTypeId::TypeId error_type() const = 0;
+
+        // returns a pointer to the held T if Ok or the held E if Err
+        virtual const void* value_ptr() const = 0;
+
+        // writes this frame alone (the held T if Ok, E::what() if Err) to sink
+        // pre-conditions:
+            // this must point to a constructed Ok or Err
+        // post-conditions:
+            // the frame has been rendered to sink without a trailing newline
+        virtual void render(TraceSink& sink) const = 0;
+
+        // returns the held value if this is an Ok<X, *>
+        // pre-conditions:
+            // this must point to a constructed Ok or Err
+        // post-conditions:
+            // if Ok and T == X, a pointer to the held T has been returned
+            // else, nullptr has been returned
+        template<class X> const X* value_if() const {
+            if (is_ok() && value_type() == LibTypeId::type_id<X>) {
+                return static_cast<const X*>(value_ptr());
+            }
+            return nullptr;
+        }
+
+        // returns the held error if this is an Err<*, X>
+        // pre-conditions:
+            // this must point to a constructed Ok or Err
+        // post-conditions:
+            // if Err and E == X, a pointer to the held E has been returned
+            // else, nullptr has been returned
+        template<class X> const X* error_if() const {
+            if (is_err() && error_type() == LibTypeId::type_id<X>) {
+                return static_cast<const X*>(value_ptr());
+            }
+            return nullptr;
+        }
+
+        // returns the next frame in the trace, or nullptr at the tail
+        const ResultBase* get_next() const {
+            return next;
+        }
+
+        // stores the argument and its trace at the tail of the list in O(1)
+        // the argument may be a Result of any T and E
+        // if this is itself part of another trace, r goes after the last frame of that trace
+        // pre-conditions:
+            // r is a valid reference to a Result and has been allocated with new
+            // r is not part of another trace
+        // post-conditions:
+            // r has been pushed to the tail and is owned by this
+            // if the operation on this thread is not sampled (see Sampler), r has been deleted instead
+        void push_back(ResultBase& r) {
+            if (!Sampler::tracing()) {
+                delete &r;
+                return;
+            }
+            link(r);
+        }
+
+        // prepares this for push_back_concurrent(), whose atomic swap cannot walk a stale tail
+        // frames may have been linked after the tail through Results that were pushed onto this (see catch_up())
+        // pre-conditions:
+            // no other thread uses this
+        // post-conditions:
+            // the tail of this is the last frame of its trace
+        void begin_concurrent() {
+            catch_up();
+        }
+
+        // stores the argument and its trace at the tail of the list, safely against other threads doing the same
+        // producers swap the tail pointer atomically and then link the old tail to r, so no lock is taken
+        // the trace must not be read, rendered or deleted until every producer has finished (e.g. been joined)
+        // pre-conditions:
+            // r is a valid reference to a Result and has been allocated with new
+            // r is not part of another trace and is not being modified by another thread
+            // this is not part of another trace
+            // begin_concurrent() has been called on this after its last non-concurrent change,
+            // and before the producers started
+            // no other thread calls a non-concurrent method of this at the same time
+        // post-conditions:
+            // r has been pushed to the tail and is owned by this
+            // appends from one thread keep their order
+            // if the operation on the calling thread is not sampled (see Sampler), r has been deleted instead
+        void push_back_concurrent(ResultBase& r) {
+            if (!Sampler::tracing()) {
+                delete &r;
+                return;
+            }
+            // r belongs to the calling thread, so its own tail can be walked without synchronization
+            r.catch_up();
+            ResultBase* last = std::atomic_ref<ResultBase*>(tail).exchange(r.tail, std::memory_order_acq_rel);
+            std::atomic_ref<ResultBase*>(last->next).store(&r, std::memory_order_release);
+        }
+
+        // moves the trace following the head of other onto the tail of this in O(1)
+        // the frames are relinked, not copied, and other may be a Result of any T and E
+        // frames that live inside other are moved to the heap first
+        // pre-conditions:
+            // other is constructed and is not part of another trace
+        // post-conditions:
+            // the frames after other have been moved to the tail of this
+            // other is a trace of one frame
+        void take_trace(ResultBase& other) {
+            if (other.next == nullptr) {
+                return;
+            }
+            if (other.inline_frames != 0) {
+                other.spill();
+            }
+            catch_up();
+            tail->next = other.next;
+            tail = other.tail;
+            other.next = nullptr;
+            other.tail = &other;
+        }
+
+#ifdef LIBRESULT_TIMESTAMPS
+        // returns the Clock::ticks() value taken when this was constructed
+        // pre-conditions:
+            // ResultBase has been constructed
+        // post-conditions:
+            // the construction timestamp has been returned
+        std::uint64_t get_stamp() const {
+            return stamp;
+        }
+
+        // returns the time in nanoseconds between the construction of the next frame and this
+        // pre-conditions:
+            // next is nullptr or holds a valid pointer to a Result
+        // post-conditions:
+            // if next is nullptr, 0 has been returned
+            // else, the signed stamp difference converted to nanoseconds has been returned
+        std::int64_t get_delta() const {
+            if (next == nullptr) {
+                return 0;
+            }
+            return Clock::to_ns(static_cast<std::int64_t>(stamp - next->stamp));
+        }
+#endif
+
+        // prints a trace for the linked list where this is the head
+        // pre-conditions:
+            // every frame is holding either a T or E value
+            // next must be nullptr or hold a valid Result pointer
+        // post-conditions:
+            // a trace has been written to sink, one frame per line
+            // if LIBRESULT_TIMESTAMPS is defined, each frame is followed by its signed delta to the next frame,
+            // as [+n ns] if the next frame was built first and [-n ns] if it was built after
+        void get_trace(TraceSink& sink) const {
+            for (const ResultBase* frame = this; frame != nullptr; frame = frame->next) {
+                frame->render(sink);
+#ifdef LIBRESULT_TIMESTAMPS
+                if (frame->next != nullptr) {
+                    // the next frame is usually built first, but a value frame is built after its head
+                    std::int64_t delta = frame->get_delta();
+                    sink.write(delta < 0 ? " [-" : " [+");
+                    sink.write(static_cast<unsigned long long>(delta < 0 ? -delta : delta));
+                    sink.write(" ns]");
+                }
+#endif
+                sink.write("\n", 1);
+            }
+        }
+
+        // prints a trace for the linked list where this is the head to stdout
+        // pre-conditions:
+            // see get_trace(TraceSink&)
+        // post-conditions:
+            // a trace has been printed to stdout and stdout has been flushed
+        void get_trace() const;
 
         // pre-conditions:
             // this->pimpl must be delete safe
+            // this->next is a delete-safe pointer
         // post-conditions
             // this->pimpl has been deleted
-        ~ResultBase();
+            // every frame after this has been deleted without recursion
+        virtual ~ResultBase();
+    };
+
+    // called by Err::unwrap() and Err::expect() in place of throwing when LIBRESULT_EXCEPTIONS is 0,
+    // after the Err has been reported to stdout; note is the argument of expect(), or nullptr
+    // it must not return (it may log err and call std::abort() or _exit(), or longjmp out); if it does, std::abort() is called
+    using UnwrapHandler = void (*)(const ResultBase& err, const char* note);
+
+    // installs the unwrap handler for every thread, nullptr restores the default, which calls std::abort()
+    // pre-conditions:
+        // handler is nullptr or does not return
+    // post-conditions:
+        // handler is used by every following unwrap of an Err, and the previous handler has been returned
+    UnwrapHandler set_unwrap_handler(UnwrapHandler handler);
+
+    // a trace frame holding a T, made by Result<T, E>::push_back(const T&)
+    // it lives inside the Result it was pushed onto while that has room (see LIBRESULT_INLINE_FRAMES), else on the heap
+    template<class T, class E> class ValueFrame : public ResultBase {
+        T value;
+      public:
+        // pre-conditions:
+            // T is copy constructable
+        // post-conditions:
+            // this holds a copy of t
+        ValueFrame(const T& t) : ResultBase(false), value(t) {}
+
+        // pre-conditions:
+            // other is not part of a trace
+        // post-conditions:
+            // this holds the moved value and the timestamp of other
+        ValueFrame(ValueFrame&& other) : ResultBase(false), value(std::move(other.value)) {
+            copy_stamp(other);
+        }
+
+        LibTypeId::TypeId value_type() const final {
+            return LibTypeId::type_id<T>;
+        }
+
+        LibTypeId::TypeId error_type() const final {
+            return LibTypeId::type_id<E>;
+        }
+
+        const void* value_ptr() const final {
+            return &value;
+        }
+
+        // writes the held T to sink with Formatter<T>
+        void render(TraceSink& sink) const final {
+            Formatter<T>::format(sink, value);
+        }
+    };
+
+    // a trace frame holding an E, made by Result<T, E>::push_back(E)
+    // it lives inside the Result it was pushed onto while that has room (see LIBRESULT_INLINE_FRAMES), else on the heap
+    template<class T, class E> class ErrorFrame : public ResultBase {
+        E error;
+      public:
+        // pre-conditions:
+            // E is copy constructable
+        // post-conditions:
+            // this holds a copy of e, which has been counted by ErrorStats
+        ErrorFrame(const E& e) : ResultBase(true), error(e) {
+            ErrorRecorder::record(error);
+        }
+
+        // selects the constructor that takes an E which has been counted already
+        struct Uncounted {};
+
+        // pre-conditions:
+            // E is copy constructable and e has been counted by ErrorStats
+        // post-conditions:
+            // this holds a copy of e, which has not been counted again
+        ErrorFrame(const E& e, Uncounted) : ResultBase(true), error(e) {}
+
+        // pre-conditions:
+            // other is not part of a trace
+        // post-conditions:
+            // this holds the moved error and the timestamp of other
+        ErrorFrame(ErrorFrame&& other) : ResultBase(true), error(std::move(other.error)) {
+            copy_stamp(other);
+        }
+
+        LibTypeId::TypeId value_type() const final {
+            return LibTypeId::type_id<T>;
+        }
+
+        LibTypeId::TypeId error_type() const final {
+            return LibTypeId::type_id<E>;
+        }
+
+        const void* value_ptr() const final {
+            return &error;
+        }
+
+        // writes the held E like Err::render() does
+        void render(TraceSink& sink) const final {
+            render_error(sink, error);
+        }
     };
 
     // abstract base class that resolves to either an Ok or an Err
-    template<class T, class E> class Result : protected ResultBase {
+    template<class T, class E> class Result : public ResultBase {
+#if LIBRESULT_INLINE_FRAMES > 0
+        static constexpr std::size_t frame_align = alignof(ValueFrame<T, E>) > alignof(ErrorFrame<T, E>) ? alignof(ValueFrame<T, E>) : alignof(ErrorFrame<T, E>);
+        static constexpr std::size_t frame_bytes = sizeof(ValueFrame<T, E>) > sizeof(ErrorFrame<T, E>) ? sizeof(ValueFrame<T, E>) : sizeof(ErrorFrame<T, E>);
+        static constexpr std::size_t frame_size = (frame_bytes + frame_align - 1) / frame_align * frame_align;
+
+        // room for the first LIBRESULT_INLINE_FRAMES value frames pushed onto this, so that
+        // shallow traces need no allocation and stay next to their head in memory
+        // every Result carries it, including the ones used as frames, so the default is kept small
+        alignas(frame_align) unsigned char frames[LIBRESULT_INLINE_FRAMES][frame_size];
+#endif
+
       protected:
-        // a pointer to the next Result in the trace
-        Result* next;
+        // links a new Frame made from xs, inside this if there is room and no other frame has been linked yet
+        // pre-conditions:
+            // Frame is ValueFrame<T, E> or ErrorFrame<T, E> and is constructable from xs
+        // post-conditions:
+            // the frame has been linked to the tail, whether or not the operation is sampled
+        template<class Frame, class... Xs> void push_frame(const Xs&... xs) {
+#if LIBRESULT_INLINE_FRAMES > 0
+            catch_up();
+            if (inline_frames < LIBRESULT_INLINE_FRAMES && tail == last_inline()) {
+                link(*new (frames[inline_frames]) Frame(xs...));
+                inline_frames++;
+                return;
+            }
+#endif
+            link(*new Frame(xs...));
+        }
 
+        // moves the frames that live inside this to the heap, so that they can outlive this
+        // pre-conditions:
+            // this is constructed
+        // post-conditions:
+            // inline_frames == 0 and the trace holds the same values in the same order
+        void spill() override {
+#if LIBRESULT_INLINE_FRAMES > 0
+            ResultBase* rest = last_inline()->next;
+            ResultBase* frame = next;
+            ResultBase* moved_tail = this;
+            for (unsigned i = 0; i < inline_frames; i++) {
+                ResultBase* following = frame->next;
+                ResultBase* moved = frame->is_err()
+                    ? static_cast<ResultBase*>(new ErrorFrame<T, E>(std::move(static_cast<ErrorFrame<T, E>&>(*frame))))
+                    : static_cast<ResultBase*>(new ValueFrame<T, E>(std::move(static_cast<ValueFrame<T, E>&>(*frame))));
+                if (tail == frame) {
+                    tail = moved;
+                }
+                frame->next = nullptr;
+                frame->~ResultBase();
+                moved_tail->next = moved;
+                moved_tail = moved;
+                frame = following;
+            }
+            moved_tail->next = rest;
+            inline_frames = 0;
+#endif
+        }
       public:
         // copy constructor:
         // pre-conditions:
             // v is a valid pointer to a T or E object
+            // is_err is true if v points to an E
         // post-conditions:
             // ResultBase has been constructed with v
-        Result<T, E>(void* const& v) : next(nullptr), ResultBase(v) {}
+        Result(void* const& v, bool is_err) : ResultBase(v, is_err) {}
+
+        // pre-conditions:
+            // this is constructed
+        // post-conditions:
+            // the frames that live inside this have been destroyed
+            // the rest of the trace is left for ~ResultBase() to delete
+        ~Result() override {
+#if LIBRESULT_INLINE_FRAMES > 0
+            if (inline_frames == 0) {
+                return;
+            }
+            ResultBase* rest = last_inline()->next;
+            ResultBase* frame = next;
+            for (unsigned i = 0; i < inline_frames; i++) {
+                ResultBase* following = frame->next;
+                frame->next = nullptr;
+                frame->~ResultBase();
+                frame = following;
+            }
+            next = rest;
+            inline_frames = 0;
+#endif
+        }
         
-        // returns the held T or throws the held E
+        // returns the held T or throws the held E (calls the unwrap handler instead if LIBRESULT_EXCEPTIONS is 0)
         // pre-conditions:
             // ResultBase is holding a valid pointer to a T or E
         // post-conditions:
@@ -68,107 +995,253 @@ namespace LibResult {
         virtual T unwrap() const = 0;
 
         // returns the held T 
-        // or prints the argument before throwing E
+        // or prints the argument before throwing E (calls the unwrap handler instead if LIBRESULT_EXCEPTIONS is 0)
         // pre-conditions:
             // ResultBase is holding a valid pointer to a T or E
         // post-conditions:
             // the held value is returned if Ok or thrown if Err
         virtual T expect(std::string) const = 0;
 
-        // stores the argument at the tail of the list
+        // returns a copy of the held T, or fallback if this is an Err, without throwing in either case
         // pre-conditions:
-            // next is nullptr or holds a valid pointer to a Result
-            // r is a valid reference to a Result and has been allocated with new
+            // ResultBase is holding a valid pointer to a T or E
         // post-conditions:
-            // r has been pushed to the tail
-        void push_back(Result& r) {
-            if (next == nullptr) {
-                next = &r;
-            } else {
-                next->push_back(r);
+            // the held value has been returned if Ok, else fallback
+        T unwrap_or(T fallback) const {
+            if (is_ok()) {
+                return *static_cast<const T*>(value_ptr());
             }
-        };
+            return fallback;
+        }
+
+        using ResultBase::push_back;
 
-        // newly allocates an Ok(arg) and stores it to the tail of the list
+        // stores a frame holding a copy of the argument to the tail of the list
+        // the first LIBRESULT_INLINE_FRAMES such frames live inside this, the rest are allocated
         // pre-conditions:
-            // next is nullptr or holds a valid pointer to a Result
             // argument is copy constructable
         // post-conditions:
-            // new Ok(arg) has been pushed back to the tail
+            // a ValueFrame holding the argument has been pushed back to the tail,
+            // unless the operation is not sampled (see Sampler)
         void push_back(const T& t_other) {
-            if (next == nullptr) {
-                next = new Ok<T, E>(t_other);
-            } else {
-                next->push_back(t_other);
+            if (!Sampler::tracing()) {
+                return;
             }
+            push_frame<ValueFrame<T, E>>(t_other);
         };
 
-        // newly allocates an Err(arg) and stores it to the tail of the list
+        // stores a frame holding a copy of the argument to the tail of the list
+        // the first LIBRESULT_INLINE_FRAMES such frames live inside this, the rest are allocated
         // pre-conditions:
-            // next is nullptr or holds a valid pointer to a Result
             // argument is copy constructable
         // post-conditions:
-            // new Err(arg) has been pushed back to the tail
+            // an ErrorFrame holding the argument has been pushed back to the tail and counted by ErrorStats,
+            // unless the operation is not sampled (see Sampler)
         void push_back(E e_other) { // TODO: pass in by reference
-            if (next == nullptr) {
-                next = new Err<T, E>(e_other);
-            } else {
-                next->push_back(e_other);
+            if (!Sampler::tracing()) {
+                return;
             }
+            push_frame<ErrorFrame<T, E>>(e_other);
         };
 
-        // prints a trace for the linked list where this is the head
+        // newly allocates a copy of the argument and stores it to the tail of the list
+        // if T opted into shared_payload, the new frame shares the argument's T instead of copying it
         // pre-conditions:
-            // this is holding either a T or E value
-            // if holding E, then what() must be a method of E
-            // if holding T, then T must have a "<<" operation
-            // next must be nullptr or hold a valid Result pointer
+            // the argument is a constructed Ok
         // post-conditions:
-            // a trace has been printed to stdout
-        void get_trace() {
-            if (this->is_err()) {
-                Err<T, E>* this_err_ptr = static_cast<Err<T, E>*>(this);
-                std::cout << this_err_ptr->what() << std::endl;
-            } else {
-                std::cout << this->unwrap() << std::endl;
-            }
-            if (next != nullptr) {
-                next->get_trace();
+            // new Ok(ok) has been pushed back to the tail, unless the operation is not sampled (see Sampler)
+            // the argument is unchanged
+        void push_back_copy(const Ok<T, E>& ok) {
+            if (!Sampler::tracing()) {
+                return;
             }
+            link(*new Ok<T, E>(ok));
         }
 
-        // checks if this points to an Ok
+        // calls ok_f with the held T if Ok, or the handler fitting the held E if Err
         // pre-conditions:
-            // this must point to a constructed Ok or Err
+            // ok_f is callable with a const T&
+            // hs were created with on<X>() and E supports Err::match()
         // post-conditions:
-            // if Ok, then true has been returned
-            // else, false has been returned
-        virtual bool is_ok() const = 0;
+            // the result of the called function has been returned (see Err::match())
+        template<class F, class... Hs> std::common_type_t<std::invoke_result_t<F&, const T&>, handler_result_t<Hs...>>
+        match(F ok_f, Hs... hs) const {
+            if (this->is_ok()) {
+                return ok_f(*static_cast<const T*>(this->value_ptr()));
+            }
+            return static_cast<const Err<T, E>*>(this)->match(hs...);
+        }
 
-        // checks if this points to an Err
-        // pre-conditions:
-            // this must point to a constructed Ok or Err
-        // post-conditions:
-            // if Err, then true has been returned
-            // else, false has been returned
-        virtual bool is_err() const = 0;
+        LibTypeId::TypeId value_type() const final {
+            return LibTypeId::type_id<T>;
+        }
 
-        // pre-conditions:
-            // this->next is a delete-safe pointer
-        // post-conditions:
-            // this->next has been deleted
-        virtual ~Result<T, E>() {
-            delete next;
+        LibTypeId::TypeId error_type() const final {
+            return LibTypeId::type_id<E>;
         }
     };
+    // opts T into shared Ok payloads: specialize it as std::true_type, before any Ok<T, E> is used, with
+    // template<> struct LibResult::shared_payload<T> : std::true_type {};
+    // copies of an Ok<T, E> (and trace frames made from one with push_back_copy()) then share one
+    // immutable refcounted T instead of each holding a deep copy, and a mutation copies T only if it is shared
+    template<class T> struct shared_payload : std::false_type {};
+
+    // how an Ok stores its T behind the generic pointer of ResultBase
+    // by default each Ok owns a new-allocated T
+    template<class T, bool Shared = shared_payload<T>::value> struct Payload {
+        // allocates a T from args
+        template<class... A> static void* make(A&&... args) {
+            return new T(std::forward<A>(args)...);
+        }
+
+        // takes over a new-allocated T
+        static void* adopt(T* t) {
+            return t;
+        }
+
+        // returns the T behind v
+        static T& get(void* v) {
+            return *static_cast<T*>(v);
+        }
+
+        // returns storage for a copy of the T behind v
+        static void* copy(void* v) {
+            return make(get(v));
+        }
+
+        // returns storage for a move of the T behind v
+        static void* move(void* v) {
+            return make(std::move(get(v)));
+        }
+
+        // returns storage holding t in place of v, reusing v
+        static void* assign(void* v, const T& t) {
+            get(v) = t;
+            return v;
+        }
+
+        // returns storage holding the T behind other in place of v
+        static void* assign_from(void* v, void* other) {
+            get(v) = get(other);
+            return v;
+        }
+
+        // returns storage holding the moved T behind other in place of v
+        static void* assign_move(void* v, void* other) {
+            get(v) = std::move(get(other));
+            return v;
+        }
+
+        // returns storage behind which the T may be modified without affecting other Oks
+        static void* unshare(void* v) {
+            return v;
+        }
+
+        // frees the storage
+        static void release(void* v) {
+            delete static_cast<T*>(v);
+        }
+    };
+
+    // storage for a T that opted into shared_payload: an immutable T with a reference count
+    template<class T> struct Payload<T, true> {
+        struct Block {
+            std::atomic<std::size_t> refs;
+            T value;
+            template<class... A> Block(A&&... args) : refs(1), value(std::forward<A>(args)...) {}
+        };
+
+        static Block* block(void* v) {
+            return static_cast<Block*>(v);
+        }
+
+        template<class... A> static void* make(A&&... args) {
+            return new Block(std::forward<A>(args)...);
+        }
+
+        // moves the T into a block, since a block cannot take over a separately allocated T
+        static void* adopt(T* t) {
+            void* v = make(std::move(*t));
+            delete t;
+            return v;
+        }
+
+        static T& get(void* v) {
+            return block(v)->value;
+        }
+
+        // shares the block
+        static void* copy(void* v) {
+            block(v)->refs.fetch_add(1, std::memory_order_relaxed);
+            return v;
+        }
+
+        // shares the block, since the source may still be read by other Oks
+        static void* move(void* v) {
+            return copy(v);
+        }
+
+        // assigns in place if v is not shared, else allocates a new block for t
+        static void* assign(void* v, const T& t) {
+            if (block(v)->refs.load(std::memory_order_acquire) == 1) {
+                get(v) = t;
+                return v;
+            }
+            void* fresh = make(t);
+            release(v);
+            return fresh;
+        }
+
+        // shares the block of other
+        static void* assign_from(void* v, void* other) {
+            void* shared = copy(other);
+            release(v);
+            return shared;
+        }
+
+        static void* assign_move(void* v, void* other) {
+            return assign_from(v, other);
+        }
+
+        // copies the T into a block of its own if v is shared
+        static void* unshare(void* v) {
+            if (block(v)->refs.load(std::memory_order_acquire) == 1) {
+                return v;
+            }
+            void* fresh = make(get(v));
+            release(v);
+            return fresh;
+        }
+
+        // drops a reference, freeing the block with the last one
+        static void release(void* v) {
+            if (block(v)->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete block(v);
+            }
+        }
+    };
+
     template<class T, class E> class Ok : public Result<T, E> { 
-        // returns the held T value by reference
+        using Storage = Payload<T>;
+
+        // returns the held T value by reference, for reading
         // pre-conditions:
             // ResultBase is holding a valid T ptr
         // post-conditions:
             // the held T value has been returned by reference
         T& get_wrapped() const {
-            return *static_cast<T*>(ResultBase::unwrap());
+            return Storage::get(ResultBase::unwrap());
+        }
+
+        // returns the held T value by reference, for writing
+        // pre-conditions:
+            // ResultBase is holding a valid T ptr
+        // post-conditions:
+            // if the T was shared with other Oks, this now holds a copy of its own
+            // the held T value has been returned by reference
+        T& mutable_wrapped() {
+            ResultBase::set(Storage::unshare(ResultBase::unwrap()));
+            return get_wrapped();
         }
       public:
         // default constructor:
@@ -176,21 +1249,22 @@ namespace LibResult {
             // T is default constructable
         // post-conditions:
             // this has been constructed with a new T
-        Ok() : Result<T, E>(new T) {}
+        Ok() : Result<T, E>(Storage::make(), false) {}
 
         // copy constructor
         // pre-conditions:
             // the argument is a constructed Ok
         // post-conditions:
-            // this->get_wrapped() is a new-allocated copy of the T held by the argument
-        Ok(const Ok& other_ok) : Result<T, E>(new T(other_ok.get_wrapped())) {} 
+            // this->get_wrapped() is a new-allocated copy of the T held by the argument,
+            // or the same T if T opted into shared_payload
+        Ok(const Ok& other_ok) : Result<T, E>(Storage::copy(other_ok.ResultBase::unwrap()), false) {} 
         
         // copy constructor
         // pre-conditions:
             // the argument is a constructed T
         // post-conditions:
             // this->get_wrapped() is a new-allocated copy of the argument
-        Ok(const T& other_t) : Result<T, E>(new T(other_t)) {}
+        Ok(const T& other_t) : Result<T, E>(Storage::make(other_t), false) {}
         
         // move semantics:
 
@@ -198,19 +1272,21 @@ namespace LibResult {
             // the argument is a new-allocated pointer to a T
         // post-conditions:
             // this has taken ownership of the argument
-        Ok(T* other_t_ptr) : Result<T, E>(other_t_ptr) {}
+            // if T opted into shared_payload, the argument has been moved into a new block and deleted
+        Ok(T* other_t_ptr) : Result<T, E>(Storage::adopt(other_t_ptr), false) {}
         
         // pre-conditions:
             // the argument is a constructed Ok
         // post-conditions:
-            // this wrapped value is a new-allocated move of the argument's wrapped value
-        Ok(Ok&& other_ok) : Result<T, E>(new T(std::move(other_ok.get_wrapped()))) {} 
+            // this wrapped value is a new-allocated move of the argument's wrapped value,
+            // or the argument's T, shared, if T opted into shared_payload
+        Ok(Ok&& other_ok) : Result<T, E>(Storage::move(other_ok.ResultBase::unwrap()), false) {} 
         
         // pre-conditions:
             // argument is a constructed T
         // post-conditions:
             // this wrapped value is a new-allocated std::move of the argument
-        Ok(T&& other_t) : Result<T, E>(new T(std::move(other_t))) {}
+        Ok(T&& other_t) : Result<T, E>(Storage::make(std::move(other_t)), false) {}
 
         // returns the wrapped value
         // pre-conditions:
@@ -230,23 +1306,32 @@ namespace LibResult {
             return get_wrapped();
         }
 
-        // checks if this points to an Ok (used by Results)
-        bool is_ok() const final {
-            return true;
+        // moves the wrapped value out
+        // pre-conditions:
+            // this wrapped value is a constructed T
+        // post-conditions:
+            // this wrapped value has been moved into the returned T (after copying it, if it was shared)
+            // this wrapped value is a moved-from T
+        T take() {
+            return std::move(mutable_wrapped());
         }
 
-        // checks if this points to an Err (used by Results)
-        bool is_err() const final {
-            return false;
+        // returns a pointer to the held T (used by type-erased frames)
+        const void* value_ptr() const final {
+            return &get_wrapped();
+        }
+
+        // writes the held T to sink with Formatter<T>
+        void render(TraceSink& sink) const final {
+            Formatter<T>::format(sink, get_wrapped());
         }
 
         // pre-conditions:
             // this wrapped value is new-allocated
         // post-conditions:
-            // this wrapped value is deleted 
+            // this wrapped value is deleted (or released, if T opted into shared_payload)
         ~Ok() override {
-            T* this_t_ptr = static_cast<T*>(ResultBase::unwrap());
-            delete this_t_ptr;
+            Storage::release(ResultBase::unwrap());
         }
 
         // copy assignment
@@ -256,12 +1341,12 @@ namespace LibResult {
             // this is constructed 
         // post-conditions:
             // this wrapped value == argument
+            // if the T was shared with other Oks, they keep the old value
         Ok& operator=(const T& other_t) {
-            T* this_t_ptr = static_cast<T*>(ResultBase::unwrap());
-            if (&other_t == this_t_ptr) {
+            if (&other_t == &get_wrapped()) {
                 return *this;
             }
-            *this_t_ptr = other_t;
+            ResultBase::set(Storage::assign(ResultBase::unwrap(), other_t));
             return *this;
         }
 
@@ -271,13 +1356,12 @@ namespace LibResult {
             // T is copy assignable
             // this is constructed
         // post-conditions:
-            // this wrapped value is a copy of the argument's wrapped value
+            // this wrapped value is a copy of the argument's wrapped value (or shares it, if T opted into shared_payload)
         Ok& operator=(const Ok& other_ok) {
             if (&other_ok == this) {
                 return *this;
             }
-            T* this_t_ptr = static_cast<T*>(ResultBase::unwrap());
-            *this_t_ptr = other_ok.get_wrapped();
+            ResultBase::set(Storage::assign_from(ResultBase::unwrap(), other_ok.ResultBase::unwrap()));
             return *this;
         }
 
@@ -287,12 +1371,11 @@ namespace LibResult {
         // post-conditions:
             // this wrapped ptr is deleted and replaced with argument
         Ok& operator=(T* other_t_ptr) {
-            T* this_t_ptr = static_cast<T*>(ResultBase::unwrap());
-            if (other_t_ptr == this_t_ptr) {
+            if (other_t_ptr == &get_wrapped()) {
                 return *this;
             }
-            delete this_t_ptr;
-            ResultBase::set(other_t_ptr);
+            Storage::release(ResultBase::unwrap());
+            ResultBase::set(Storage::adopt(other_t_ptr));
             return *this;
         }
 
@@ -302,17 +1385,21 @@ namespace LibResult {
             // argument is constructed
             // this is constructed
         // post-conditions:
-            // this wrapped value is a std::move of argument's wrapped value
+            // this wrapped value is a std::move of argument's wrapped value (or shares it, if T opted into shared_payload)
         Ok& operator=(Ok<T, E>&& other_ok) { 
             if (&other_ok == this) {
                 return *this;
             }
-            T* this_t_ptr = static_cast<T*>(ResultBase::unwrap());
-            *this_t_ptr = std::move(other_ok.get_wrapped());
+            ResultBase::set(Storage::assign_move(ResultBase::unwrap(), other_ok.ResultBase::unwrap()));
             return *this;
         }
     };
+
     template<class T, class E> class Err : public Result<T, E> {        
+        template<class T2, class E2> friend class Err;
+        // builds Errs from errors it has already counted
+        friend class Validated<T, E>;
+
         // returns the held E value
         // pre-conditions:
             // ResultBase is holding a valid E ptr
@@ -321,27 +1408,92 @@ namespace LibResult {
         E& get_wrapped() const {
             return *static_cast<E*>(ResultBase::unwrap());
         }
+
+        // selects the constructor that takes over an E without counting it again
+        struct Adopt {};
+
+        // pre-conditions:
+            // the argument is a new-allocated pointer to an E that has already been counted
+        // post-conditions:
+            // this has taken ownership of the argument
+        Err(E* other_e_ptr, Adopt) : Result<T, E>(other_e_ptr, true) {}
+
+        // where this has been propagated by LIBRESULT_TRY, innermost first
+        // source_location is one pointer to static data, so recording a site never allocates
+        std::source_location sites[LIBRESULT_TRY_DEPTH];
+
+        // the number of propagations, which may exceed LIBRESULT_TRY_DEPTH
+        unsigned propagations = 0;
+
+        // counts the new E and lets Sampler force-sample the operation it was created in
+        void created() {
+            ErrorRecorder::record(get_wrapped());
+            Sampler::error();
+        }
+
+        // moves a list of errors into a new Err, the first as its E and the others as frames after it, in order
+        // the errors have been counted when they were found, so none is counted again, and the frames are kept
+        // whether or not the operation is sampled, as the errors are the result rather than its trace
+        // pre-conditions:
+            // [first, last) holds at least one E, and E is move constructable
+        // post-conditions:
+            // the new Err has been returned, holding the moved first E followed by a frame for each other E
+        static Err& adopt_all(E* first, E* last) {
+            Err& head = *new Err(new E(std::move(*first)), Adopt());
+            for (E* e = first + 1; e != last; e++) {
+                head.template push_frame<ErrorFrame<T, E>>(*e, typename ErrorFrame<T, E>::Uncounted());
+            }
+            return head;
+        }
+
+        // prints the held E before it is thrown by unwrap() or expect() (or handed to the unwrap handler)
+        // E::what() is used when E has one, else E is formatted as an error code with Formatter<E>
+        void report(const char* note) const {
+            if constexpr (has_what<E>::value) {
+                ResultBase::report_unwrap(this->what(), note, LIBRESULT_EXCEPTIONS);
+            } else {
+                ArraySink<64> text;
+                Formatter<E>::format(text, get_wrapped());
+                ResultBase::report_unwrap(text.c_str(), note, LIBRESULT_EXCEPTIONS);
+            }
+        }
+
+        // throws the wrapped value, or hands this to the unwrap handler if LIBRESULT_EXCEPTIONS is 0
+        [[noreturn]] void fail(const char* note) const {
+            report(note);
+#if LIBRESULT_EXCEPTIONS
+            throw get_wrapped();
+#else
+            ResultBase::unwrap_failed(*this, note);
+#endif
+        }
       public:
         // default constructor:
         // pre-conditions:
             // E is default constructable
         // post-conditions:
             // this has been constructed with a new E
-        Err() : Result<T, E>(new E) {}
+            // the new E has been counted by ErrorStats and Sampler
+        Err() : Result<T, E>(new E, true) {
+            created();
+        }
         
         // copy constructor
         // pre-conditions:
             // the argument is a constructed Err
         // post-conditions:
             // this->get_wrapped() is a new-allocated copy of the E held by the argument
-        Err(const Err& other_err) : Result<T, E>(new E(std::move(other_err.get_wrapped()))) {}
+        Err(const Err& other_err) : Result<T, E>(new E(std::move(other_err.get_wrapped())), true) {}
  
         // copy constructor
         // pre-conditions:
             // the argument is a constructed E
         // post-conditions:
             // this->get_wrapped() is a new-allocated copy of the argument
-        Err(const E& other_e) : Result<T, E>(new E(other_e)) {}
+            // the new E has been counted by ErrorStats and Sampler
+        Err(const E& other_e) : Result<T, E>(new E(other_e), true) {
+            created();
+        }
         
         // move semantics:
 
@@ -349,28 +1501,33 @@ namespace LibResult {
             // the argument is a new-allocated pointer to an E
         // post-conditions:
             // this has taken ownership of the argument
-        Err(E* other_e_ptr) : Result<T, E>(other_e_ptr) {}
+            // the argument has been counted by ErrorStats and Sampler
+        Err(E* other_e_ptr) : Result<T, E>(other_e_ptr, true) {
+            created();
+        }
         
         // pre-conditions:
             // the argument is a constructed Err
         // post-conditions:
             // this wrapped value is a new-allocated move of the argument's wrapped value 
-        Err(Err&& other_err) : Result<T, E>(std::move(other_err.get_wrapped())) {} 
+        Err(Err&& other_err) : Result<T, E>(std::move(other_err.get_wrapped()), true) {} 
         
         // pre-conditions:
             // argument is a constructed E
         // post-conditions:
             // this wrapped value is a new-allocated std::move of the argument 
-        Err(E&& other_e) : Result<T, E>(new E(std::move(other_e))) {}
+            // the new E has been counted by ErrorStats and Sampler
+        Err(E&& other_e) : Result<T, E>(new E(std::move(other_e)), true) {
+            created();
+        }
         
         // throws the wrapped value
         // pre-conditions:
             // this wrapped value is a constructed E
         // post-conditions:
-            // this wrapped value has been thrown
+            // this wrapped value has been thrown, or this has been passed to the unwrap handler if LIBRESULT_EXCEPTIONS is 0
         T unwrap() const final {
-            std::cout << "throwing unwrapped Err " << this->what() << std::endl;
-            throw get_wrapped();
+            fail(nullptr);
         }
  
         // the same thing as this->unwrap() but also prints the argument to stdout
@@ -379,15 +1536,99 @@ namespace LibResult {
             // this wrapped value is a constructed E
         // post-conditions:
             // this wrapped value has been thrown and s has been printed to stdout
+            // (or this has been passed to the unwrap handler with s if LIBRESULT_EXCEPTIONS is 0)
         T expect(std::string s) const final {
-            std::cout << "throwing unwrapped Err " << this->what() << ": " << s << std::endl;
-            throw get_wrapped();
+            fail(s.c_str());
         } 
-        bool is_ok() const final {
-            return false;
+        // returns a pointer to the held E (used by type-erased frames)
+        const void* value_ptr() const final {
+            return &get_wrapped();
         }
-        bool is_err() const final {
-            return true;
+
+        // writes E::what() for the held E to sink (or the E itself with Formatter<E> if it has no what()),
+        // followed by its backtrace if E carries one
+        void render(TraceSink& sink) const final {
+            render_error(sink, get_wrapped());
+            for (unsigned i = 0; i < site_count(); i++) {
+                const std::source_location& site = sites[i];
+                sink.write("\n    propagated through ");
+                sink.write(site.function_name());
+                sink.write(" (");
+                sink.write(site.file_name());
+                sink.write(":");
+                sink.write(static_cast<unsigned long long>(site.line()));
+                sink.write(")");
+            }
+            if (propagation_count() > site_count()) {
+                sink.write("\n    propagated ");
+                sink.write(static_cast<unsigned long long>(propagation_count() - site_count()));
+                sink.write(" more times");
+            }
+        }
+
+        // records a location that this has been propagated through (used by LIBRESULT_TRY)
+        // pre-conditions:
+            // none
+        // post-conditions:
+            // if fewer than LIBRESULT_TRY_DEPTH sites are stored, site has been appended
+            // the propagation count has been incremented
+        void add_site(const std::source_location& site) noexcept {
+            if (propagations < LIBRESULT_TRY_DEPTH) {
+                sites[propagations] = site;
+            }
+            propagations++;
+        }
+
+        // returns the number of propagations, which may exceed LIBRESULT_TRY_DEPTH
+        unsigned propagation_count() const noexcept {
+            return propagations;
+        }
+
+        // returns the number of stored propagation sites
+        unsigned site_count() const noexcept {
+            return propagation_count() < LIBRESULT_TRY_DEPTH ? propagation_count() : LIBRESULT_TRY_DEPTH;
+        }
+
+        // returns the i-th propagation site, innermost first
+        // pre-conditions:
+            // i < site_count()
+        // post-conditions:
+            // the i-th recorded source location has been returned
+        const std::source_location& get_site(unsigned i) const noexcept {
+            return sites[i];
+        }
+
+        // calls the handler fitting the dynamic type of the held E, without RTTI
+        // pre-conditions:
+            // hs were created with on<X>()
+            // E has type_id() and is_a() methods (see LibException::Exception)
+        // post-conditions:
+            // the first handler for the exact type of the held E has been called,
+            // or else the first handler for a base of it
+            // the handler's result has been returned, or a value-initialized result if none matched
+        template<class... Hs> handler_result_t<Hs...> match(Hs... hs) const {
+            using R = handler_result_t<Hs...>;
+            std::tuple<Hs&...> handlers(hs...);
+            return Dispatcher<R, E, Hs...>::run(get_wrapped(), handlers);
+        }
+
+        // moves the held E and the trace into a newly allocated Err<T2, E>
+        // this lets a trace continue across a pipeline stage that changes T
+        // pre-conditions:
+            // this has been allocated with new and is not part of another trace
+        // post-conditions:
+            // a new Err<T2, E> holding this E, timestamp, propagation sites and trace has been returned
+            // this has been deleted
+        template<class T2> Err<T2, E>& into() {
+            Err<T2, E>& converted = *(new Err<T2, E>(static_cast<E*>(ResultBase::unwrap()), typename Err<T2, E>::Adopt()));
+            for (unsigned i = 0; i < site_count(); i++) {
+                converted.sites[i] = sites[i];
+            }
+            converted.propagations = propagations;
+            ResultBase::set(nullptr);
+            converted.take_frame(*this);
+            delete this;
+            return converted;
         }
 
         // returns E::what() for the wrapped E
@@ -497,6 +1738,44 @@ namespace LibResult {
             return *this;
         }
     };
-}
 
+    // an Err on its way out of a function through LIBRESULT_TRY
+    // it converts to the Result type that the function returns
+    template<class T, class E> class Propagation {
+        Err<T, E>& err;
+        std::source_location site;
+      public:
+        // pre-conditions:
+            // e has been allocated with new
+        // post-conditions:
+            // this refers to e and holds the propagation site
+        Propagation(Err<T, E>& e, const std::source_location& l) : err(e), site(l) {}
+
+        // pre-conditions:
+            // the Propagation has not been converted before
+        // post-conditions:
+            // the site has been recorded on the Err
+            // if T2 == T, the Err itself has been returned
+            // else, the Err has been moved into an Err<T2, E> with Err::into(), which has been returned
+        template<class T2> operator Result<T2, E>&() const {
+            if constexpr (std::is_same_v<T2, T>) {
+                err.add_site(site);
+                return err;
+            } else {
+                Err<T2, E>& converted = err.template into<T2>();
+                converted.add_site(site);
+                return converted;
+            }
+        }
+    };
 
+    // starts the propagation of an Err out of the enclosing function (used by LIBRESULT_TRY)
+    // pre-conditions:
+        // r is an Err
+    // post-conditions:
+        // a Propagation referring to r and site has been returned
+    template<class T, class E> Propagation<T, E> propagate(Result<T, E>& r, const std::source_location& site) {
+        return Propagation<T, E>(static_cast<Err<T, E>&>(r), site);
+    }
+}
+#endif
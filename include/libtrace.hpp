@@ -0,0 +1,59 @@
+#ifndef LIBTRACE_HPP
+#define LIBTRACE_HPP
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <libresult.hpp>
+
+// std::ostream support for traces, kept out of libresult.hpp so that code which only
+// creates and checks Results does not pay for parsing <iostream> or its static initializers
+namespace LibTrace {
+    // a TraceSink that writes to an std::ostream
+    class OstreamSink : public LibResult::TraceSink {
+        std::ostream& os;
+      public:
+        using LibResult::TraceSink::write;
+
+        // pre-conditions:
+            // os outlives this
+        // post-conditions:
+            // this writes to os
+        OstreamSink(std::ostream& os);
+
+        // writes n characters starting at s to the stream
+        void write(const char* s, std::size_t n) override;
+    };
+
+    // prints the trace where head is the head to os
+    // pre-conditions:
+        // see LibResult::ResultBase::get_trace(TraceSink&)
+    // post-conditions:
+        // a trace has been printed to os, one frame per line, and os has been flushed
+    void get_trace(const LibResult::ResultBase& head, std::ostream& os);
+
+    // returns the trace where head is the head as a string
+    // pre-conditions:
+        // see LibResult::ResultBase::get_trace(TraceSink&)
+    // post-conditions:
+        // the text that get_trace() would print has been returned
+    std::string to_string(const LibResult::ResultBase& head);
+
+    // prints a single frame (without the rest of its trace) to os
+    // pre-conditions:
+        // frame is a constructed Ok or Err
+    // post-conditions:
+        // the frame has been rendered to os without a trailing newline
+    void render(const LibResult::ResultBase& frame, std::ostream& os);
+
+    // a LibResult::Formatter that uses the "<<" operation of X
+    // opt in per type with: template<> struct LibResult::Formatter<X> : LibTrace::StreamFormatter<X> {};
+    template<class X> struct StreamFormatter {
+        static void format(LibResult::TraceSink& sink, const X& x) {
+            std::ostringstream ss;
+            ss << x;
+            const std::string& s = ss.str();
+            sink.write(s.data(), s.size());
+        }
+    };
+}
+#endif
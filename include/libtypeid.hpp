@@ -0,0 +1,35 @@
+#ifndef LIBTYPEID_HPP
+#define LIBTYPEID_HPP
+#include <cstdint>
+
+namespace LibTypeId {
+    // a compact identifier for a type that needs neither RTTI nor registration
+    using TypeId = std::uint32_t;
+
+    // FNV-1a hash of a cstring, usable in constant expressions
+    // pre-conditions:
+        // s is a valid cstring
+    // post-conditions:
+        // the 32-bit FNV-1a hash of s has been returned
+    constexpr TypeId hash(const char* s) {
+        TypeId h = 2166136261u;
+        while (*s != '\0') {
+            h ^= static_cast<unsigned char>(*s++);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // hashes the signature of this function, which spells out X
+    // pre-conditions:
+        // none
+    // post-conditions:
+        // an id unique to X (barring hash collisions) has been returned
+    template<class X> constexpr TypeId make() {
+        return hash(__PRETTY_FUNCTION__);
+    }
+
+    // the id of X, identical in every translation unit
+    template<class X> constexpr TypeId type_id = make<X>();
+}
+#endif
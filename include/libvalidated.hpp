@@ -0,0 +1,223 @@
+#ifndef LIBVALIDATED_HPP
+#define LIBVALIDATED_HPP
+#include <libresult.hpp>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// accumulates the errors of independent checks in one pass, where a Result stops at the first one
+namespace LibResult {
+    // either a T, or every E that the checks behind it produced
+    // the Es are kept by value in one contiguous list, in the order they were found
+    // the traces of Errs absorbed by check() or zip() are kept and handed on by into_result()
+    template<class T, class E> class Validated {
+        template<class T2, class E2> friend class Validated;
+
+        // always holds a value while errors is empty
+        std::optional<T> value;
+        std::vector<E> errors;
+        // Errs absorbed with a trace behind them, whose trace is moved into into_result()
+        std::vector<std::unique_ptr<ResultBase>> traces;
+
+        Validated() = default;
+
+        // appends e to the errors, counting it as the constructor of an Err would
+        // into_result() does not count the errors again, and check() takes Errs that are counted already
+        void found(const E& e) {
+            errors.push_back(e);
+            ErrorRecorder::record(errors.back());
+            Sampler::error();
+        }
+      public:
+        using value_type = T;
+        using error_type = E;
+
+        // pre-conditions:
+            // T is copy or move constructable
+        // post-conditions:
+            // this is valid and holds t
+        Validated(const T& t) : value(t) {}
+        Validated(T&& t) : value(std::move(t)) {}
+
+        Validated(Validated&&) = default;
+        Validated& operator=(Validated&&) = default;
+
+        // pre-conditions:
+            // E is copy constructable
+        // post-conditions:
+            // a Validated that holds no value and the single error e has been returned
+            // e has been counted by ErrorStats and Sampler, like the E of a new Err
+        static Validated invalid(const E& e) {
+            Validated v;
+            v.found(e);
+            return v;
+        }
+
+        // takes ownership of a Result and converts it
+        // pre-conditions:
+            // r is a constructed Ok or Err that has been allocated with new
+        // post-conditions:
+            // if r is an Ok, a valid Validated holding its moved value has been returned
+            // else, a Validated holding a copy of its E and its trace has been returned
+            // r has been deleted, unless it is kept for its trace
+        static Validated from(Result<T, E>& r) {
+            Validated v;
+            if (std::optional<T> t = v.check(r)) {
+                v.value.emplace(std::move(*t));
+            }
+            return v;
+        }
+
+        // true if no check has failed
+        bool is_valid() const {
+            return errors.empty();
+        }
+
+        // the number of errors found so far
+        std::size_t error_count() const {
+            return errors.size();
+        }
+
+        // the errors found so far, contiguous and in the order they were found
+        const std::vector<E>& get_errors() const {
+            return errors;
+        }
+
+        // pre-conditions:
+            // this holds a value, which is always the case if is_valid()
+        // post-conditions:
+            // the held value has been returned
+        T& get() {
+            return *value;
+        }
+        const T& get() const {
+            return *value;
+        }
+
+        // reserves room for n errors, so a record with n fields to check allocates its error list once
+        void reserve(std::size_t n) {
+            errors.reserve(n);
+        }
+
+        // records e unless ok holds
+        // pre-conditions:
+            // E is copy constructable
+        // post-conditions:
+            // if !ok, e has been appended to the errors and counted by ErrorStats and Sampler
+        Validated& ensure(bool ok, const E& e) {
+            if (!ok) {
+                found(e);
+            }
+            return *this;
+        }
+
+        // takes ownership of the Result of an independent check
+        // pre-conditions:
+            // r is a constructed Ok or Err that has been allocated with new
+        // post-conditions:
+            // if r is an Ok, its moved value has been returned and r deleted
+            // else, its E has been appended to the errors and nullopt returned;
+            // r is kept for its trace if it has one, else deleted
+        template<class U> std::optional<U> check(Result<U, E>& r) {
+            std::unique_ptr<ResultBase> owned(&r);
+            if (r.is_ok()) {
+                return std::optional<U>(static_cast<Ok<U, E>&>(r).take());
+            }
+            errors.push_back(*r.template error_if<E>());
+            if (r.get_next() != nullptr) {
+                traces.push_back(std::move(owned));
+            }
+            return std::nullopt;
+        }
+
+        // appends the errors and traces of other to this, leaving this's value alone
+        // pre-conditions:
+            // other is constructed
+        // post-conditions:
+            // other's errors follow the errors of this and other has no errors or traces left
+        template<class U> Validated& merge(Validated<U, E>&& other) {
+            errors.insert(errors.end(), std::make_move_iterator(other.errors.begin()), std::make_move_iterator(other.errors.end()));
+            other.errors.clear();
+            for (std::unique_ptr<ResultBase>& t : other.traces) {
+                traces.push_back(std::move(t));
+            }
+            other.traces.clear();
+            return *this;
+        }
+
+        // converts this to a new-allocated Result
+        // pre-conditions:
+            // this is constructed
+        // post-conditions:
+            // if valid, a new Ok holding the moved value has been returned
+            // else, a new Err holding the first error has been returned, followed in its trace by a frame for every
+            // other error and then the traces of the absorbed Errs
+            // the errors are not counted by ErrorStats again, and every one of them is kept even if the operation
+            // is not sampled (see Sampler), as they are the result rather than its trace
+            // this holds a moved-from value and no errors or traces
+        Result<T, E>& into_result() {
+            if (errors.empty()) {
+                return *new Ok<T, E>(std::move(*value));
+            }
+            Err<T, E>& head = Err<T, E>::adopt_all(errors.data(), errors.data() + errors.size());
+            for (std::unique_ptr<ResultBase>& t : traces) {
+                head.take_trace(*t);
+            }
+            errors.clear();
+            traces.clear();
+            return head;
+        }
+
+        // combines validated inputs into a Validated of f's result, see zip_with()
+        // pre-conditions:
+            // T is the result of f applied to the values of vs
+        // post-conditions:
+            // see zip_with()
+        template<class F, class... As> static Validated combine(F& f, Validated<As, E>&&... vs) {
+            if ((vs.is_valid() && ...)) {
+                return Validated(std::invoke(f, std::move(*vs.value)...));
+            }
+            Validated out;
+            out.reserve((vs.error_count() + ...));
+            (out.merge(std::move(vs)), ...);
+            return out;
+        }
+    };
+
+    // the Validated that an argument of zip() or zip_with() is turned into
+    // a Validated is moved, a Result<T, E>& is taken ownership of and converted by Validated::from()
+    template<class T, class E> Validated<T, E> as_validated(Validated<T, E>&& v) {
+        return std::move(v);
+    }
+    template<class T, class E> Validated<T, E> as_validated(Result<T, E>& r) {
+        return Validated<T, E>::from(r);
+    }
+
+    template<class F, class E, class... As> auto zip_validated(F& f, Validated<As, E>&&... vs) {
+        return Validated<std::invoke_result_t<F&, As&&...>, E>::combine(f, std::move(vs)...);
+    }
+
+    // applies f to the values of every argument if all of them are valid, else gathers all of their errors
+    // pre-conditions:
+        // every argument is a Validated<A, E> rvalue or a Result<A, E>& allocated with new, with the same E
+        // f is callable with the values of the arguments, in order
+    // post-conditions:
+        // if every argument was valid, a valid Validated holding f(values...) has been returned
+        // else, a Validated holding the errors (and traces) of every argument, in argument order, has been returned
+        // every Result argument has been taken ownership of
+    template<class F, class... Xs> auto zip_with(F&& f, Xs&&... xs) {
+        return zip_validated(f, as_validated(std::forward<Xs>(xs))...);
+    }
+
+    // zip_with() that collects the values into a tuple
+    template<class... Xs> auto zip(Xs&&... xs) {
+        return zip_with([](auto&&... values) {
+            return std::make_tuple(std::move(values)...);
+        }, std::forward<Xs>(xs)...);
+    }
+}
+#endif
@@ -0,0 +1,306 @@
+#ifndef LIBVIEWS_HPP
+#define LIBVIEWS_HPP
+#include <libresult.hpp>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+// lazy range adaptors over streams of new-allocated Result<T, E>* elements
+// every element a view yields is owned by the consumer, exactly like the Results returned by pipeline stages
+namespace LibResult::views {
+    // what and_then does after yielding an Err
+    enum class Mode {
+        // stop pulling input, so the Err is the last element
+        fail_fast,
+        // pass the Err through and keep going
+        keep_going
+    };
+
+    // deduces Result<T, E> from a pointer to a Result<T, E> or to an Ok/Err derived from it
+    template<class T, class E> Result<T, E>* as_result(Result<T, E>*);
+    template<class P> using result_of_t = std::remove_pointer_t<decltype(as_result(std::declval<P>()))>;
+
+    // extracts T and E from Result<T, E>
+    template<class R> struct result_traits;
+    template<class T, class E> struct result_traits<Result<T, E>> {
+        using value_type = T;
+        using error_type = E;
+    };
+
+    // converts an Err into a Result<U, E> without copying its E or trace
+    // pre-conditions:
+        // r is an Err that has been allocated with new
+    // post-conditions:
+        // r itself has been returned if T == U, else the Err::into<U>() conversion of r
+    template<class U, class T, class E> Result<U, E>* convert_err(Result<T, E>* r) {
+        if constexpr (std::is_same_v<T, U>) {
+            return r;
+        } else {
+            return &static_cast<Err<T, E>*>(r)->template into<U>();
+        }
+    }
+
+    // applies a pipeline stage to every Ok of the underlying range, lazily
+    // F is a stage like the ones in the integration test: Result<T, E>& -> Result<U, E>&,
+    // which takes ownership of its argument and returns a new-allocated Result
+    template<std::ranges::input_range V, class F> requires std::ranges::view<V>
+    class AndThenView : public std::ranges::view_interface<AndThenView<V, F>> {
+        using In = result_of_t<std::ranges::range_value_t<V>>;
+        using Out = std::remove_reference_t<std::invoke_result_t<F&, In&>>;
+        using U = typename result_traits<Out>::value_type;
+
+        V base;
+        F f;
+        Mode mode;
+
+      public:
+        struct sentinel {};
+
+        class iterator {
+            AndThenView* parent = nullptr;
+            std::ranges::iterator_t<V> it;
+            Out* current = nullptr;
+            // whether current is an Err, remembered because the consumer may delete current
+            bool current_err = false;
+            bool done = false;
+
+            // pulls the next input element and applies the stage to it
+            // pre-conditions:
+                // parent is valid
+            // post-conditions:
+                // current holds the next output, or done is true if the input is exhausted
+                // the input has not been pulled past an Err in fail-fast mode
+            void pull() {
+                if (it == std::ranges::end(parent->base)) {
+                    done = true;
+                    return;
+                }
+                In* in = *it;
+                if (in->is_err()) {
+                    current = convert_err<U>(in);
+                } else {
+                    current = &parent->f(*in);
+                }
+                current_err = current->is_err();
+            }
+          public:
+            using iterator_concept = std::input_iterator_tag;
+            using value_type = Out*;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+
+            // pre-conditions:
+                // p is valid for as long as this is used
+            // post-conditions:
+                // the first element has been pulled and transformed
+            explicit iterator(AndThenView* p) : parent(p), it(std::ranges::begin(p->base)) {
+                pull();
+            }
+
+            // returns the current output, which the caller takes ownership of
+            Out* operator*() const {
+                return current;
+            }
+
+            // pre-conditions:
+                // this is not at the end
+            // post-conditions:
+                // the next element has been pulled, unless the current one is an Err in fail-fast mode
+            iterator& operator++() {
+                if (parent->mode == Mode::fail_fast && current_err) {
+                    done = true;
+                    return *this;
+                }
+                ++it;
+                pull();
+                return *this;
+            }
+
+            void operator++(int) {
+                ++*this;
+            }
+
+            friend bool operator==(const iterator& i, sentinel) {
+                return i.done;
+            }
+        };
+
+        AndThenView() = default;
+
+        // pre-conditions:
+            // the elements of b are new-allocated Result<T, E>* that this takes ownership of
+        // post-conditions:
+            // nothing has been pulled from b yet
+        AndThenView(V b, F fn, Mode m) : base(std::move(b)), f(std::move(fn)), mode(m) {}
+
+        // pre-conditions:
+            // begin() is called at most once, as for any input range
+        // post-conditions:
+            // the first element has been pulled
+        iterator begin() {
+            return iterator(this);
+        }
+
+        sentinel end() const {
+            return sentinel{};
+        }
+    };
+
+    // yields the values of the leading Oks of the underlying range, moved out, and stops at the first Err
+    // each Ok is deleted when the iterator moves past it; the Err that stopped the range is kept and exposed by error()
+    template<std::ranges::input_range V> requires std::ranges::view<V>
+    class TakeOkView : public std::ranges::view_interface<TakeOkView<V>> {
+        using In = result_of_t<std::ranges::range_value_t<V>>;
+        using T = typename result_traits<In>::value_type;
+
+        V base;
+        std::unique_ptr<In> stopped_at;
+
+      public:
+        struct sentinel {};
+
+        class iterator {
+            TakeOkView* parent = nullptr;
+            std::ranges::iterator_t<V> it;
+            // the element pulled from the input, each input element is dereferenced once
+            In* current = nullptr;
+            bool done = false;
+
+            // pulls the next element, stopping at the end of the input or at an Err, which the view keeps
+            void pull() {
+                if (it == std::ranges::end(parent->base)) {
+                    done = true;
+                    return;
+                }
+                current = *it;
+                if (current->is_err()) {
+                    parent->stopped_at.reset(current);
+                    current = nullptr;
+                    done = true;
+                }
+            }
+          public:
+            using iterator_concept = std::input_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+
+            explicit iterator(TakeOkView* p) : parent(p), it(std::ranges::begin(p->base)) {
+                pull();
+            }
+
+            // moves the current value out of its Ok
+            // pre-conditions:
+                // this is not at the end
+            // post-conditions:
+                // the held value has been returned, the Ok holds a moved-from T
+            T operator*() const {
+                return static_cast<Ok<T, typename result_traits<In>::error_type>*>(current)->take();
+            }
+
+            // pre-conditions:
+                // this is not at the end
+            // post-conditions:
+                // the current Ok has been deleted and the next element pulled
+            iterator& operator++() {
+                delete current;
+                current = nullptr;
+                ++it;
+                pull();
+                return *this;
+            }
+
+            void operator++(int) {
+                ++*this;
+            }
+
+            friend bool operator==(const iterator& i, sentinel) {
+                return i.done;
+            }
+        };
+
+        TakeOkView() = default;
+
+        TakeOkView(V b) : base(std::move(b)) {}
+
+        iterator begin() {
+            return iterator(this);
+        }
+
+        sentinel end() const {
+            return sentinel{};
+        }
+
+        // returns the Err that stopped the range, or nullptr if none has been reached
+        // the Err is deleted with the view
+        const In* error() const {
+            return stopped_at.get();
+        }
+    };
+
+    template<class F> struct AndThenAdaptor {
+        F f;
+        Mode mode;
+    };
+
+    struct TakeOkAdaptor {};
+
+    struct CollectResultAdaptor {};
+
+    // lazily applies the stage f to every Ok, see AndThenView
+    // pre-conditions:
+        // f takes ownership of an Ok Result<T, E>& and returns a new-allocated Result<U, E>&
+    // post-conditions:
+        // an adaptor for "range | and_then(f)" has been returned
+    template<class F> AndThenAdaptor<std::decay_t<F>> and_then(F&& f, Mode mode = Mode::fail_fast) {
+        return AndThenAdaptor<std::decay_t<F>>{std::forward<F>(f), mode};
+    }
+
+    // yields the values of the leading Oks, see TakeOkView
+    inline constexpr TakeOkAdaptor take_ok{};
+
+    template<std::ranges::viewable_range R, class F> auto operator|(R&& r, AndThenAdaptor<F> a) {
+        return AndThenView<std::views::all_t<R>, F>(std::views::all(std::forward<R>(r)), std::move(a.f), a.mode);
+    }
+
+    template<std::ranges::viewable_range R> auto operator|(R&& r, TakeOkAdaptor) {
+        return TakeOkView<std::views::all_t<R>>(std::views::all(std::forward<R>(r)));
+    }
+
+    // drains a range of Result<T, E>* into one Result<std::vector<T>, E>, stopping at the first Err
+    // pre-conditions:
+        // the elements of r are new-allocated Result<T, E>* that this takes ownership of
+    // post-conditions:
+        // if every element was Ok, a new Ok holding their moved values has been returned
+        // else, the first Err converted with Err::into() has been returned, and nothing after it has been pulled
+        // every consumed Ok has been deleted
+    template<std::ranges::input_range R> auto& collect_result(R&& r) {
+        using In = result_of_t<std::ranges::range_value_t<R>>;
+        using T = typename result_traits<In>::value_type;
+        using E = typename result_traits<In>::error_type;
+        std::vector<T> values;
+        for (auto it = std::ranges::begin(r); it != std::ranges::end(r); ++it) {
+            In* element = *it;
+            if (element->is_err()) {
+                return *convert_err<std::vector<T>>(element);
+            }
+            std::unique_ptr<In> owned(element);
+            values.push_back(static_cast<Ok<T, E>*>(element)->take());
+        }
+        return static_cast<Result<std::vector<T>, E>&>(*(new Ok<std::vector<T>, E>(std::move(values))));
+    }
+
+    // an adaptor for "range | collect_result()"
+    inline CollectResultAdaptor collect_result() {
+        return CollectResultAdaptor{};
+    }
+
+    template<std::ranges::input_range R> auto& operator|(R&& r, CollectResultAdaptor) {
+        return collect_result(std::forward<R>(r));
+    }
+}
+#endif
@@ -0,0 +1,87 @@
+#include <libchannel.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace LibResult;
+
+// creates a zero-filled segment called name of n bytes and maps it
+// pre-conditions:
+    // name is a valid cstring of the form "/name"
+    // nothing is mapped by this yet
+// post-conditions:
+    // if 0 has been returned, the segment exists, is mapped and is owned by this
+    // else, errno of the failing call has been returned and nothing is mapped
+int SharedSegment::create(const char* name, std::size_t n) {
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return errno;
+    }
+    if (ftruncate(fd, n) != 0) {
+        int error = errno;
+        close(fd);
+        shm_unlink(name);
+        return error;
+    }
+    void* mapped = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(name);
+        return error;
+    }
+    this->name = name;
+    this->base = mapped;
+    this->size = n;
+    this->owner = true;
+    return 0;
+}
+
+// maps the existing segment called name
+// pre-conditions:
+    // name is a valid cstring of the form "/name"
+    // nothing is mapped by this yet
+// post-conditions:
+    // if 0 has been returned, the whole segment is mapped
+    // else, errno of the failing call has been returned and nothing is mapped
+int SharedSegment::open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int error = errno;
+        close(fd);
+        return error;
+    }
+    if (st.st_size == 0) {
+        // the creator has not sized the segment yet
+        close(fd);
+        return EAGAIN;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return error;
+    }
+    this->name = name;
+    this->base = mapped;
+    this->size = st.st_size;
+    return 0;
+}
+
+// pre-conditions:
+    // none
+// post-conditions:
+    // the segment has been unmapped
+    // if this created it, its name has been unlinked (processes that mapped it keep their mapping)
+SharedSegment::~SharedSegment() {
+    if (base != nullptr) {
+        munmap(base, size);
+    }
+    if (owner) {
+        shm_unlink(name.c_str());
+    }
+}
@@ -1,67 +1,300 @@
 #include <libexception.hpp>
+#include <atomic>
+#include <new>
+#ifdef LIBEXCEPTION_BACKTRACE
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <unwind.h>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#endif
 using namespace LibException;
+
+#ifdef LIBEXCEPTION_BACKTRACE
+namespace {
+    struct CaptureState {
+        void** frames;
+        unsigned depth;
+        unsigned skip;
+    };
+
+    // stores the instruction pointer of one unwound frame
+    _Unwind_Reason_Code capture_frame(_Unwind_Context* context, void* arg) {
+        CaptureState* state = static_cast<CaptureState*>(arg);
+        if (state->skip > 0) {
+            state->skip--;
+            return _URC_NO_REASON;
+        }
+        if (state->depth == LIBEXCEPTION_BACKTRACE_DEPTH) {
+            return _URC_END_OF_STACK;
+        }
+        void* ip = reinterpret_cast<void*>(_Unwind_GetIP(context));
+        if (ip == nullptr) {
+            return _URC_END_OF_STACK;
+        }
+        state->frames[state->depth++] = ip;
+        return _URC_NO_REASON;
+    }
+
+    // address to symbol results shared by every thread
+    std::shared_mutex symbol_mutex;
+    std::unordered_map<void*, std::string>& symbol_cache() {
+        static std::unordered_map<void*, std::string> cache;
+        return cache;
+    }
+
+    // looks up the symbol for address without the cache
+    std::string lookup_symbol(void* address) {
+        char buf[64];
+        Dl_info info;
+        // return addresses point past the call, so look up the byte before
+        void* call_site = static_cast<char*>(address) - 1;
+        if (dladdr(call_site, &info) == 0) {
+            snprintf(buf, sizeof(buf), "%p", address);
+            return buf;
+        }
+        if (info.dli_sname == nullptr) {
+            snprintf(buf, sizeof(buf), "(+%#tx)", static_cast<char*>(address) - static_cast<char*>(info.dli_fbase));
+            return std::string(info.dli_fname != nullptr ? info.dli_fname : "??") + buf;
+        }
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string symbol = status == 0 ? demangled : info.dli_sname;
+        free(demangled);
+        snprintf(buf, sizeof(buf), "+%#tx", static_cast<char*>(address) - static_cast<char*>(info.dli_saddr));
+        return symbol + buf;
+    }
+}
+
+// captures the return addresses of the calling stack
+// pre-conditions:
+    // none
+// post-conditions:
+    // up to LIBEXCEPTION_BACKTRACE_DEPTH addresses have been stored, innermost first
+    // the innermost skip frames (and capture() itself) have been left out
+    // nothing has been allocated
+void Backtrace::capture(unsigned skip) noexcept {
+    CaptureState state = { frames, 0, skip + 1 };
+    _Unwind_Backtrace(capture_frame, &state);
+    depth = state.depth;
+}
+
+// returns a printable symbol for a code address
+// pre-conditions:
+    // address is a return address from a captured stack
+// post-conditions:
+    // "function+0xoffset" or "module(+0xoffset)" has been returned
+    // the result is cached process-wide and remains valid until exit
+const char* Backtrace::symbolize(void* address) {
+    {
+        std::shared_lock<std::shared_mutex> lock(symbol_mutex);
+        auto found = symbol_cache().find(address);
+        if (found != symbol_cache().end()) {
+            return found->second.c_str();
+        }
+    }
+    std::string symbol = lookup_symbol(address);
+    std::unique_lock<std::shared_mutex> lock(symbol_mutex);
+    // references to unordered_map values survive rehashing, so the cstring stays valid
+    return symbol_cache().emplace(address, std::move(symbol)).first->second.c_str();
+}
+
+#endif
+
+namespace {
+    // a string in the intern table, allocated with its characters and never freed
+    struct InternNode {
+        const InternNode* next;
+        std::size_t hash;
+        std::size_t length;
+        char text[1];
+    };
+
+    // a fixed array of buckets, each a lock-free list that only ever grows at its head
+    // the number of strings is bounded by LIBEXCEPTION_INTERN_LIMIT, so the lists stay short
+    constexpr std::size_t intern_buckets = 1 << 12;
+    std::atomic<const InternNode*> intern_table[intern_buckets];
+    std::atomic<std::size_t> intern_count{0};
+
+    std::size_t intern_hash(const char* s, std::size_t n) {
+        std::size_t h = 14695981039346656037ull;
+        for (std::size_t i = 0; i < n; i++) {
+            h ^= static_cast<unsigned char>(s[i]);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // searches the nodes from first up to (not including) last for s
+    const InternNode* intern_find(const InternNode* first, const InternNode* last, std::size_t hash, const char* s, std::size_t n) {
+        for (const InternNode* node = first; node != last; node = node->next) {
+            if (node->hash == hash && node->length == n && memcmp(node->text, s, n) == 0) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+}
+
+// returns the process-wide canonical copy of the first n characters of s
+// the table is read and extended without locks, and its strings are never freed
+// pre-conditions:
+    // s points to at least n readable characters
+// post-conditions:
+    // a cstring equal to the argument has been returned, or nullptr if it is not in the table and the table is full
+    // equal arguments always return the same pointer, which remains valid until exit
+const char* LibException::intern(const char* s, std::size_t n) {
+    std::size_t hash = intern_hash(s, n);
+    std::atomic<const InternNode*>& bucket = intern_table[hash & (intern_buckets - 1)];
+    const InternNode* head = bucket.load(std::memory_order_acquire);
+    const InternNode* found = intern_find(head, nullptr, hash, s, n);
+    if (found != nullptr) {
+        return found->text;
+    }
+    if (intern_count.fetch_add(1, std::memory_order_relaxed) >= LIBEXCEPTION_INTERN_LIMIT) {
+        intern_count.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    InternNode* node = static_cast<InternNode*>(::operator new(sizeof(InternNode) + n));
+    node->hash = hash;
+    node->length = n;
+    memcpy(node->text, s, n);
+    node->text[n] = '\0';
+    node->next = head;
+    while (!bucket.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_acquire)) {
+        // another thread got in first; it may have interned the same string
+        found = intern_find(head, node->next, hash, s, n);
+        if (found != nullptr) {
+            ::operator delete(node);
+            intern_count.fetch_sub(1, std::memory_order_relaxed);
+            return found->text;
+        }
+        node->next = head;
+    }
+    return node->text;
+}
+
+// the strings of an Exception, allocated with their characters and shared by its copies
+struct Exception::Text {
+    std::atomic<std::size_t> refs;
+    char text[1];
+};
+
 // sets the location and message_location variables
 // pre-conditions:
     // l is a valid cstring
-    // this->location is delete[] safe
     // this->message is a valid cstring
-    // this->message_location is delete[] safe
+    // this->owned is nullptr
 // post-conditions:
-    // l has been copied to this->location
-    // if location != "" then message_location holds message + " in " + location
-    // else message_location == message
+    // this->location points to the interned copy of l
+    // if location != "" then message_location points to the interned message + " in " + location
+    // else message_location points to message
+    // if the intern table is full, the strings that could not be interned have been copied to this->owned instead
 void Exception::set_location(const char* l) {
-    delete[] this->location;
-    this->location = new char[strlen(l) + 1];
-    strcpy(this->location, l);
-    
-    delete[] this->message_location;
-    if (strcmp(this->location, "") == 0) {
-        this->message_location = new char[strlen(message) + 1];
-        strcpy(message_location, message);
-    } else {
-        this->message_location = new char[strlen(message) + strlen(l) + 5];
-        strcpy(this->message_location, this->message);
-        strcat(this->message_location, " in ");
-        strcat(this->message_location, this->location);
+    std::size_t location_length = strlen(l);
+    if (location_length == 0) {
+        this->location = "";
+        this->message_location = message;
+        return;
+    }
+    const char* interned = intern(l, location_length);
+    std::size_t message_length = strlen(message);
+    std::size_t length = message_length + 4 + location_length;
+    // the joined string is only built to look it up, so keep it on the stack when it fits
+    char local[256];
+    char* joined = length < sizeof(local) ? local : new char[length + 1];
+    memcpy(joined, message, message_length);
+    memcpy(joined + message_length, " in ", 4);
+    memcpy(joined + message_length + 4, l, location_length);
+    joined[length] = '\0';
+    const char* interned_joined = interned == nullptr ? nullptr : intern(joined, length);
+    if (interned_joined == nullptr) {
+        // the table is full, so this owns the joined string, followed by the location if it was not interned either
+        std::size_t size = length + 1 + (interned == nullptr ? location_length + 1 : 0);
+        Text* text = static_cast<Text*>(::operator new(sizeof(Text) + size));
+        new (&text->refs) std::atomic<std::size_t>(1);
+        memcpy(text->text, joined, length + 1);
+        if (interned == nullptr) {
+            memcpy(text->text + length + 1, l, location_length + 1);
+            interned = text->text + length + 1;
+        }
+        this->owned = text;
+        interned_joined = text->text;
+    }
+    if (joined != local) {
+        delete[] joined;
     }
+    this->location = interned;
+    this->message_location = interned_joined;
+}
+
+// drops this's reference to owned
+// pre-conditions:
+    // owned is nullptr or a block this holds a reference to
+// post-conditions:
+    // the block has been freed if this held the last reference, and owned is nullptr
+void Exception::release() noexcept {
+    if (owned != nullptr && owned->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        owned->refs.~atomic();
+        ::operator delete(owned);
+    }
+    owned = nullptr;
 }
 
 // copy constructors:
 
 // pre-conditions:
     // m and l are non-null ptrs 
+    // m remains valid for the lifetime of this (e.g. a string literal)
 // post-conditions:
-    // the contents of m has been copied to this->message
-    // the contents of l has been copied to this->location
+    // this->message points to m
+    // this->location points to the interned copy of l
 Exception::Exception(const char* m, const char* l) : message(m) {
     this->set_location(l);    
+#ifdef LIBEXCEPTION_BACKTRACE
+    backtrace.capture(1);
+#endif
 };
 // pre-conditions:
-    // other is constructed or otherwise has a non-null location
+    // other is constructed
 // post-conditions:
-    // the contents of other.location has been copied to this->location
-    // this->message is default
-Exception::Exception(const Exception& other) {
-    this->set_location(other.location);
+    // the message, location and message_location pointers of other have been copied
+    // the block holding other's strings is shared
+Exception::Exception(const Exception& other) : message(other.message), location(other.location), message_location(other.message_location), owned(other.owned) {
+    if (owned != nullptr) {
+        owned->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+#ifdef LIBEXCEPTION_BACKTRACE
+    backtrace = other.backtrace;
+#endif
 }
 // pre-conditions:
     // l is a non-null ptr 
 // post-conditions
-    // the contents of l is copied to this->location
+    // this->location points to the interned copy of l
     // this->message is default
 Exception::Exception(const char* l) {
     this->set_location(l);
+#ifdef LIBEXCEPTION_BACKTRACE
+    backtrace.capture(1);
+#endif
 }
 
 // default constructor
 // pre-conditions:
-    // this->location == nullptr or is otherwise delete[] safe
+    // none
 // post-conditions:
-    // "" has been copied to this->location
+    // this->location points to the interned ""
     // this->message is default
 Exception::Exception() {
     this->set_location("");
+#ifdef LIBEXCEPTION_BACKTRACE
+    backtrace.capture(1);
+#endif
 }
 
 // returns the error message + location where the error occured
@@ -84,27 +317,48 @@ const char* Exception::where() const {
     return this->location;
 }
 
+#ifdef LIBEXCEPTION_BACKTRACE
+// returns the call stack captured when this (or the Exception it was copied from) was constructed
+// pre-conditions:
+    // this has been constructed
+// post-conditions:
+    // the captured backtrace has been returned
+const Backtrace& Exception::get_backtrace() const {
+    return backtrace;
+}
+#endif
+
 // copy assignment
 // pre-conditions:
     // other is constructed and has a valid location and message
 // post-conditions:
-    // other.location has been copied to this->location
+    // the message, location and message_location pointers of other have been copied
+    // the block holding other's strings is shared, and the one of this released
+    // if LIBEXCEPTION_BACKTRACE is defined, other's backtrace has been copied to this
 Exception& Exception::operator=(const Exception& other) {
     if (this == &other) {
         return *this;
     }
-    set_location(other.location);
+    if (other.owned != nullptr) {
+        other.owned->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    release();
+    owned = other.owned;
+    message = other.message;
+    location = other.location;
+    message_location = other.message_location;
+#ifdef LIBEXCEPTION_BACKTRACE
+    backtrace = other.backtrace;
+#endif
     return *this;
 }
 
 // pre-conditions:
-    // this->location is delete[] safe
-    // this->message_location is delete[] safe
+    // none
 // post-conditions:
-    // this->location is deleted
-    // this->message_location is deleted
+    // this has been destroyed, its block of strings freed if no copy shares it
+    // the interned strings are kept for other Exceptions
 Exception::~Exception() {
-    delete[] location;
-    delete[] message_location;
+    release();
 }
 
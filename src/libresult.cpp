@@ -1,5 +1,34 @@
 #include <libresult.hpp>
+#include <liberrorstats.hpp>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
 using namespace LibResult;
+#ifdef LIBRESULT_TIMESTAMPS
+// calibrates Clock::ticks() against steady_clock over a short busy wait
+double Clock::ns_per_tick() {
+    static const double ratio = [] {
+        using namespace std::chrono;
+        steady_clock::time_point t0 = steady_clock::now();
+        std::uint64_t c0 = ticks();
+        while (steady_clock::now() - t0 < milliseconds(2)) {}
+        steady_clock::time_point t1 = steady_clock::now();
+        std::uint64_t c1 = ticks();
+        if (c1 == c0) {
+            return 1.0;
+        }
+        return static_cast<double>(duration_cast<nanoseconds>(t1 - t0).count()) / (c1 - c0);
+    }();
+    return ratio;
+}
+#endif
+
 struct ResultBase::Impl {
     void* v; 
     void* unwrap() {
@@ -17,10 +46,417 @@ void* ResultBase::unwrap() const {
 void ResultBase::set(void* const& v) {
     pimpl->set(v);
 }
-ResultBase::ResultBase(void* const& v) : pimpl(new Impl) {
+ResultBase::ResultBase(void* const& v, bool is_err) : pimpl(new Impl), next(nullptr), tail(this), err(is_err) {
     pimpl->set(v);
+#ifdef LIBRESULT_TIMESTAMPS
+    stamp = Clock::ticks();
+#endif
+}
+ResultBase::ResultBase(bool is_err) : pimpl(nullptr), next(nullptr), tail(this), err(is_err) {
+#ifdef LIBRESULT_TIMESTAMPS
+    stamp = Clock::ticks();
+#endif
 }
 ResultBase::~ResultBase() {
     delete pimpl;
+    // detach each frame before deleting it so that long traces don't recurse
+    // the frames that live inside a frame are destroyed by it, so carry on from after them
+    ResultBase* frame = next;
+    while (frame != nullptr) {
+        ResultBase* last = frame->last_inline();
+        ResultBase* following = last->next;
+        last->next = nullptr;
+        delete frame;
+        frame = following;
+    }
+}
+
+
+// writes the decimal form of a number, as std::ostream does by default
+// (so a double gets 6 significant digits), using std::to_chars without allocating or reading the locale
+// pre-conditions:
+    // none
+// post-conditions:
+    // the number has been formatted on the stack and written
+void TraceSink::write(long long i) {
+    char buf[24];
+    std::to_chars_result end = std::to_chars(buf, buf + sizeof(buf), i);
+    write(buf, end.ptr - buf);
+}
+void TraceSink::write(unsigned long long u) {
+    char buf[24];
+    std::to_chars_result end = std::to_chars(buf, buf + sizeof(buf), u);
+    write(buf, end.ptr - buf);
+}
+void TraceSink::write(double d) {
+    char buf[32];
+    std::to_chars_result end = std::to_chars(buf, buf + sizeof(buf), d, std::chars_format::general, 6);
+    write(buf, end.ptr - buf);
+}
+
+namespace {
+    // the buffer behind every ThreadBufferSink of a thread
+    thread_local std::string trace_buffer;
+}
+
+// pre-conditions:
+    // none
+// post-conditions:
+    // this appends to the end of the calling thread's buffer
+ThreadBufferSink::ThreadBufferSink() : buffer(trace_buffer), start(trace_buffer.size()) {}
+
+// pre-conditions:
+    // sinks created on this thread after this one have been destroyed
+// post-conditions:
+    // the characters written to this have been removed from the thread's buffer
+ThreadBufferSink::~ThreadBufferSink() {
+    buffer.resize(start);
+}
+
+// prints a trace for the linked list where this is the head to stdout
+// pre-conditions:
+    // see get_trace(TraceSink&)
+// post-conditions:
+    // a trace has been printed to stdout and stdout has been flushed
+void ResultBase::get_trace() const {
+    ThreadBufferSink sink;
+    get_trace(sink);
+    fwrite(sink.data(), 1, sink.size(), stdout);
+    fflush(stdout);
+}
+
+// prints "throwing unwrapped Err <what>[: <note>]" to stdout, without "throwing " if the Err is not thrown
+// pre-conditions:
+    // what is a valid cstring, note is a valid cstring or nullptr
+// post-conditions:
+    // the line has been printed to stdout and stdout has been flushed
+void ResultBase::report_unwrap(const char* what, const char* note, bool throwing) {
+    const char* prefix = throwing ? "throwing " : "";
+    if (note == nullptr) {
+        printf("%sunwrapped Err %s\n", prefix, what);
+    } else {
+        printf("%sunwrapped Err %s: %s\n", prefix, what, note);
+    }
+    fflush(stdout);
 }
 
+namespace {
+    std::atomic<UnwrapHandler> unwrap_handler{nullptr};
+}
+
+// pre-conditions:
+    // handler is nullptr or does not return
+// post-conditions:
+    // handler is used by every following unwrap of an Err, and the previous handler has been returned
+UnwrapHandler LibResult::set_unwrap_handler(UnwrapHandler handler) {
+    return unwrap_handler.exchange(handler);
+}
+
+// pre-conditions:
+    // err is a constructed Err, note is a valid cstring or nullptr
+// post-conditions:
+    // does not return: the handler has been called, and std::abort() if the handler returned
+void ResultBase::unwrap_failed(const ResultBase& err, const char* note) {
+    UnwrapHandler handler = unwrap_handler.load();
+    if (handler != nullptr) {
+        handler(err, note);
+    }
+    std::abort();
+}
+
+namespace {
+    enum class SampleMode : int {
+        all,
+        every,
+        bucket
+    };
+
+    // the process-wide Sampler configuration
+    std::atomic<int> sample_mode{static_cast<int>(SampleMode::all)};
+    std::atomic<std::uint32_t> sample_every{1};
+    std::atomic<double> bucket_rate{0};
+    std::atomic<double> bucket_burst{1};
+    std::atomic<std::uint32_t> error_every{0};
+    // bumped on every change, so threads refill their buckets with the new burst
+    std::atomic<std::uint32_t> sample_generation{0};
+
+    // the decisions of one thread
+    struct SamplerState {
+        std::uint32_t generation = ~0u;
+        std::uint64_t operations = 0;
+        std::uint64_t errors = 0;
+        double tokens = 0;
+        std::chrono::steady_clock::time_point refilled;
+    };
+    thread_local SamplerState sampler_state;
+
+    void configure(SampleMode mode) {
+        sample_mode.store(static_cast<int>(mode), std::memory_order_relaxed);
+        sample_generation.fetch_add(1, std::memory_order_release);
+    }
+}
+
+// samples every operation (the default)
+void Sampler::all() {
+    configure(SampleMode::all);
+}
+
+// samples the first of every n operations begun on each thread
+// pre-conditions:
+    // n > 0
+// post-conditions:
+    // from the next begin() on, 1 in n operations on each thread are sampled
+void Sampler::every(std::uint32_t n) {
+    sample_every.store(n, std::memory_order_relaxed);
+    configure(SampleMode::every);
+}
+
+// samples operations while a per-thread token bucket has a token
+// pre-conditions:
+    // rate >= 0 and burst >= 1
+// post-conditions:
+    // each thread's bucket starts full with burst tokens and refills at rate tokens per second
+    // from the next begin() on, an operation is sampled if it can take a token
+void Sampler::per_second(double rate, double burst) {
+    bucket_rate.store(rate, std::memory_order_relaxed);
+    bucket_burst.store(burst, std::memory_order_relaxed);
+    configure(SampleMode::bucket);
+}
+
+// makes 1 in n of the Errs created in unsampled operations on each thread turn tracing on
+// pre-conditions:
+    // none
+// post-conditions:
+    // the Err and the frames recorded after it are traced, frames dropped before it are not
+void Sampler::force_errors(std::uint32_t n) {
+    error_every.store(n, std::memory_order_relaxed);
+    sample_generation.fetch_add(1, std::memory_order_release);
+}
+
+// decides whether the operation starting on this thread is sampled
+// pre-conditions:
+    // none
+// post-conditions:
+    // the decision has been stored for this thread and returned
+bool Sampler::begin() {
+    SamplerState& state = sampler_state;
+    std::uint32_t generation = sample_generation.load(std::memory_order_acquire);
+    if (state.generation != generation) {
+        state = SamplerState();
+        state.generation = generation;
+        state.tokens = bucket_burst.load(std::memory_order_relaxed);
+        state.refilled = std::chrono::steady_clock::now();
+    }
+    switch (static_cast<SampleMode>(sample_mode.load(std::memory_order_relaxed))) {
+      case SampleMode::all:
+        sampled = true;
+        break;
+      case SampleMode::every:
+        sampled = state.operations++ % sample_every.load(std::memory_order_relaxed) == 0;
+        break;
+      case SampleMode::bucket: {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - state.refilled).count();
+        state.refilled = now;
+        state.tokens = std::min(bucket_burst.load(std::memory_order_relaxed),
+            state.tokens + elapsed * bucket_rate.load(std::memory_order_relaxed));
+        sampled = state.tokens >= 1;
+        if (sampled) {
+            state.tokens -= 1;
+        }
+        break;
+      }
+    }
+    return sampled;
+}
+
+// turns tracing on for the rest of an unsampled operation if force_errors() picks this Err
+void Sampler::sample_error() noexcept {
+    std::uint32_t n = error_every.load(std::memory_order_relaxed);
+    if (n != 0 && sampler_state.errors++ % n == 0) {
+        sampled = true;
+    }
+}
+
+namespace {
+    // one error site counted by one thread
+    struct SiteCounter {
+        LibTypeId::TypeId type;
+        std::string location;
+        std::string description;
+        // only the owning thread writes count, snapshots read it
+        std::atomic<std::uint64_t> count{0};
+        // the following are only touched by snapshot() under the registry mutex
+        std::uint64_t reset_base = 0;
+        std::uint64_t last_seen = 0;
+        SiteCounter(LibTypeId::TypeId t, const char* l, const char* d) : type(t), location(l), description(d) {}
+    };
+
+    struct SiteKey {
+        LibTypeId::TypeId type;
+        std::string_view location;
+        bool operator==(const SiteKey& other) const {
+            return type == other.type && location == other.location;
+        }
+    };
+
+    struct SiteKeyHash {
+        std::size_t operator()(const SiteKey& key) const {
+            return std::hash<std::string_view>()(key.location) * 31 + key.type;
+        }
+    };
+
+    // the counters of one thread
+    // the owner looks sites up without locking, since it is the only writer of index;
+    // the mutex orders its insertions against snapshots walking counters
+    struct Shard {
+        std::mutex mutex;
+        std::deque<SiteCounter> counters;
+        std::unordered_map<SiteKey, SiteCounter*, SiteKeyHash> index;
+    };
+
+    // every shard ever created; shards outlive their threads so no counts are lost
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::chrono::steady_clock::time_point last_snapshot = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    Shard& local_shard() {
+        thread_local Shard* shard = nullptr;
+        if (shard == nullptr) {
+            std::unique_ptr<Shard> created(new Shard);
+            shard = created.get();
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            registry().shards.push_back(std::move(created));
+        }
+        return *shard;
+    }
+
+    // appends s to out with JSON string escaping
+    void append_json_string(std::string& out, const std::string& s) {
+        out += '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+}
+
+// counts one error at a site in the calling thread's shard
+// pre-conditions:
+    // location and description are valid cstrings
+// post-conditions:
+    // the counter for (type, location) in this thread's shard has been incremented
+    // the counter has been allocated if this thread had not seen the site before
+void ErrorRecorder::record(LibTypeId::TypeId type, const char* location, const char* description) {
+    Shard& shard = local_shard();
+    auto found = shard.index.find(SiteKey{type, location});
+    SiteCounter* counter;
+    if (found != shard.index.end()) {
+        counter = found->second;
+    } else {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        counter = &shard.counters.emplace_back(type, location, description);
+        shard.index.emplace(SiteKey{type, counter->location}, counter);
+    }
+    // single writer, so a plain load and store avoids a locked read-modify-write
+    counter->count.store(counter->count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// sums every thread's shard into one row per site
+// pre-conditions:
+    // none
+// post-conditions:
+    // the rows have been returned sorted by descending count, then type and location
+    // rates cover the time since the previous snapshot
+    // if reset is true, counts of later snapshots start again from zero
+std::vector<ErrorStats::Row> ErrorStats::snapshot(bool reset) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - reg.last_snapshot).count();
+    reg.last_snapshot = now;
+
+    std::unordered_map<SiteKey, Row, SiteKeyHash> merged;
+    for (std::unique_ptr<Shard>& shard : reg.shards) {
+        std::lock_guard<std::mutex> shard_lock(shard->mutex);
+        for (SiteCounter& counter : shard->counters) {
+            std::uint64_t count = counter.count.load(std::memory_order_relaxed);
+            std::uint64_t recent = count - counter.last_seen;
+            counter.last_seen = count;
+            Row& row = merged.try_emplace(SiteKey{counter.type, counter.location},
+                Row{counter.type, counter.location, counter.description, 0, 0.0}).first->second;
+            row.count += count - counter.reset_base;
+            row.rate += seconds > 0 ? recent / seconds : 0.0;
+            if (reset) {
+                counter.reset_base = count;
+            }
+        }
+    }
+
+    std::vector<Row> rows;
+    rows.reserve(merged.size());
+    for (auto& entry : merged) {
+        rows.push_back(std::move(entry.second));
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        if (a.count != b.count) {
+            return a.count > b.count;
+        }
+        if (a.type != b.type) {
+            return a.type < b.type;
+        }
+        return a.location < b.location;
+    });
+    return rows;
+}
+
+// formats rows as an aligned text table
+std::string ErrorStats::table(const std::vector<Row>& rows) {
+    std::string out;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%12s %14s  %s\n", "count", "rate/s", "error");
+    out += buf;
+    for (const Row& row : rows) {
+        snprintf(buf, sizeof(buf), "%12llu %14.1f  ", static_cast<unsigned long long>(row.count), row.rate);
+        out += buf;
+        out += row.description.empty() ? row.location : row.description;
+        snprintf(buf, sizeof(buf), " [%08x]\n", row.type);
+        out += buf;
+    }
+    return out;
+}
+
+// formats rows as a JSON array of objects
+std::string ErrorStats::json(const std::vector<Row>& rows) {
+    std::string out = "[";
+    char buf[64];
+    for (std::size_t i = 0; i < rows.size(); i++) {
+        const Row& row = rows[i];
+        snprintf(buf, sizeof(buf), "%s{\"type\":%u,\"location\":", i == 0 ? "" : ",", row.type);
+        out += buf;
+        append_json_string(out, row.location);
+        out += ",\"description\":";
+        append_json_string(out, row.description);
+        snprintf(buf, sizeof(buf), ",\"count\":%llu,\"rate\":%.3f}",
+            static_cast<unsigned long long>(row.count), row.rate);
+        out += buf;
+    }
+    out += "]";
+    return out;
+}
@@ -0,0 +1,48 @@
+#include <libtrace.hpp>
+using namespace LibTrace;
+
+// pre-conditions:
+    // os outlives this
+// post-conditions:
+    // this writes to os
+OstreamSink::OstreamSink(std::ostream& os) : os(os) {}
+
+// writes n characters starting at s to the stream
+void OstreamSink::write(const char* s, std::size_t n) {
+    os.write(s, n);
+}
+
+// prints the trace where head is the head to os
+// pre-conditions:
+    // see LibResult::ResultBase::get_trace(TraceSink&)
+// post-conditions:
+    // a trace has been printed to os, one frame per line, and os has been flushed
+void LibTrace::get_trace(const LibResult::ResultBase& head, std::ostream& os) {
+    // render into the thread's buffer first, so the stream is written (and its sentry taken) once
+    LibResult::ThreadBufferSink sink;
+    head.get_trace(sink);
+    os.write(sink.data(), sink.size());
+    os.flush();
+}
+
+// returns the trace where head is the head as a string
+// pre-conditions:
+    // see LibResult::ResultBase::get_trace(TraceSink&)
+// post-conditions:
+    // the text that get_trace() would print has been returned
+std::string LibTrace::to_string(const LibResult::ResultBase& head) {
+    LibResult::ThreadBufferSink sink;
+    head.get_trace(sink);
+    return std::string(sink.data(), sink.size());
+}
+
+// prints a single frame (without the rest of its trace) to os
+// pre-conditions:
+    // frame is a constructed Ok or Err
+// post-conditions:
+    // the frame has been rendered to os without a trailing newline
+void LibTrace::render(const LibResult::ResultBase& frame, std::ostream& os) {
+    LibResult::ThreadBufferSink sink;
+    frame.render(sink);
+    os.write(sink.data(), sink.size());
+}
@@ -9,27 +9,54 @@ using namespace LibException;
 using namespace LibResult;
 
 struct DivByZero : public Exception {
+    LIBEXCEPTION_TYPE(DivByZero, Exception)
     DivByZero() : Exception("Division by zero", "") {}
     DivByZero(const char* l) : Exception("Division by zero", l) {}
     DivByZero(const Exception& other) : Exception("Division by zero", other.where()) {} 
 };
 struct NegativeLog : public Exception {
+    LIBEXCEPTION_TYPE(NegativeLog, Exception)
     NegativeLog() : Exception("Negative logarithm", "") {}
     NegativeLog(const char* l) : Exception("Negative logarithm", l) {}
     NegativeLog(const Exception& other) : Exception("Negative logarithm", other.where()) {}
 };
 // we presume the user intends to work with real numbers only
 struct NegativeRoot : public Exception {
+    LIBEXCEPTION_TYPE(NegativeRoot, Exception)
     NegativeRoot() : Exception("Negative root", "") {}
     NegativeRoot(const char* l) : Exception("Negative root", l) {}
     NegativeRoot(const Exception& other) : Exception("Negative root", other.where()) {}
 };
+struct NotANumber : public Exception {
+    LIBEXCEPTION_TYPE(NotANumber, Exception)
+    NotANumber() : Exception("Not a number", "") {}
+    NotANumber(const char* l) : Exception("Not a number", l) {}
+    NotANumber(const Exception& other) : Exception("Not a number", other.where()) {}
+};
 struct RecievedErr : public Exception {
+    LIBEXCEPTION_TYPE(RecievedErr, Exception)
     RecievedErr() : Exception("Recieved Err value", "") {}
     RecievedErr(const char* l) : Exception("Recieved Err value", l) {}
     RecievedErr(const Exception& other) : Exception("Recieved Err value", other.where()) {}
 };
 
+// the trace of a crosses from Result<string, Exception> to Result<float, Exception>
+Result<float, Exception>& parse(Result<std::string, Exception>& a) {
+    if (a.is_err()) {
+        return static_cast<Err<std::string, Exception>&>(a).into<float>();
+    }
+    std::string s = a.unwrap();
+    char* end = nullptr;
+    float f = strtof(s.c_str(), &end);
+    if (s.empty() || *end != '\0') {
+        Result<float, Exception>& b = *(new Err<float, Exception>(new NotANumber("parse")));
+        b.push_back(a);
+        return b;
+    }
+    Result<float, Exception>& b = *(new Ok<float, Exception>(f));
+    b.push_back(a);
+    return b;
+}
 Result<float, Exception>& divide(Result<float, Exception>& a, Result<float, Exception>& b) {
     if (b.is_ok() && a.is_ok()) {
         if (b.unwrap() != 0) {
@@ -58,12 +85,9 @@ Result<float, Exception>& divide(Result<float, Exception>& a, Result<float, Exce
         return c;
     }
 }
-Result<float, Exception>& nat_log(Result<float, Exception>& a) {
-    if (a.is_err()) {
-        Result<float, Exception>& b = *(new Err<float, Exception>(new RecievedErr("nat_log")));
-        b.push_back(a);
-        return b;
-    } else if (a.unwrap() < 0) {
+Result<float, Exception>& nat_log(Result<float, Exception>& r) {
+    Result<float, Exception>& a = LIBRESULT_TRY(r);
+    if (a.unwrap() < 0) {
         Err<float, Exception>& b = *(new Err<float, Exception>(new NegativeLog("nat_log")));
         b.push_back(a);
         return b;
@@ -73,12 +97,9 @@ Result<float, Exception>& nat_log(Result<float, Exception>& a) {
         return b;
     } 
 }
-Result<float, Exception>& square_rt(Result<float, Exception>& a) {
-    if (a.is_err()) {
-        Result<float, Exception>& b = *(new Err<float, Exception>(new RecievedErr("square_rt")));
-        b.push_back(a);
-        return b;
-    } else if (a.unwrap() < 0) {
+Result<float, Exception>& square_rt(Result<float, Exception>& r) {
+    Result<float, Exception>& a = LIBRESULT_TRY(r);
+    if (a.unwrap() < 0) {
         Err<float, Exception>& b = *(new Err<float, Exception>(new NegativeRoot("square_rt")));
         b.push_back(a);
         return b;
@@ -92,7 +113,7 @@ Result<float, Exception>& square_rt(Result<float, Exception>& a) {
 int main() {
     using namespace std;
     cout << "beginning integration test:" << endl;
-    Result<float, Exception>& a = *(new Ok<float, Exception>(10));
+    Result<float, Exception>& a = parse(*(new Ok<string, Exception>("10")));
     Result<float, Exception>& b = *(new Ok<float, Exception>(0.0));
     Result<float, Exception>& c = square_rt(nat_log(divide(a, b)));
     if (c.is_err()) {
@@ -0,0 +1,159 @@
+#include <libchannel.hpp>
+#include <iostream>
+#include <exception>
+#include <assert.h>
+#include <bits/stdc++.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace LibResult;
+struct Reading {
+    int sensor;
+    double value;
+};
+enum class Fault : int {
+    none,
+    overrange,
+    offline
+};
+using Channel = ResultChannel<Reading, Fault>;
+
+// a segment name that other test runs on the machine won't use
+std::string channel_name(const char* suffix) {
+    return "/libresult_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+struct TestChannel {
+    static void create() {
+        using namespace std;
+        cout << "ResultChannel::create().. ";
+        string name = channel_name("create");
+        Result<Channel*, int>& created = Channel::create(name.c_str(), 5);
+        assert(created.is_ok());
+        Channel* channel = created.unwrap();
+        assert(channel->capacity() == 8);
+        Result<Channel*, int>& again = Channel::create(name.c_str(), 5);
+        assert(again.is_err() && *again.error_if<int>() == EEXIST);
+        delete &again;
+        Result<Channel*, int>& opened = Channel::open(name.c_str());
+        assert(opened.is_ok());
+        delete opened.unwrap();
+        delete &opened;
+        // another layout is refused
+        Result<ResultChannel<int, Fault>*, int>& other = ResultChannel<int, Fault>::open(name.c_str());
+        assert(other.is_err() && *other.error_if<int>() == EPROTO);
+        delete &other;
+        delete channel;
+        delete &created;
+        Result<Channel*, int>& missing = Channel::open(name.c_str());
+        assert(missing.is_err() && *missing.error_if<int>() == ENOENT);
+        delete &missing;
+        cout << "passed!" << endl;
+    }
+    static void send() {
+        using namespace std;
+        cout << "ResultChannel::send().. ";
+        string name = channel_name("send");
+        Result<Channel*, int>& created = Channel::create(name.c_str(), 2);
+        Channel& channel = *created.unwrap();
+        assert(channel.try_receive() == nullptr);
+        Result<Reading, Fault>* ok = new Ok<Reading, Fault>(Reading{1, 2.5});
+        ok->push_back(Reading{1, 2.0});
+        ok->push_back(*(new Ok<string, Fault>("not copied")));
+        ok->push_back(Fault::offline);
+        assert(channel.try_send(*ok));
+        Result<Reading, Fault>* err = new Err<Reading, Fault>(Fault::overrange);
+        assert(channel.try_send(*err));
+        // the ring is full
+        assert(!channel.try_send(*err));
+        const Channel::Message* m = channel.try_receive();
+        assert(m != nullptr && m->is_ok());
+        assert(m->value().sensor == 1 && m->value().value == 2.5);
+        assert(m->trace_size() == 3);
+        assert(m->trace(0).value_if()->value == 2.0);
+        assert(m->trace(1).is_ok() && m->trace(1).value_if() == nullptr);
+        assert(m->trace(1).get_type() == LibTypeId::type_id<string>);
+        assert(*m->trace(2).error_if() == Fault::offline);
+        // the message is read in place
+        const char* base = reinterpret_cast<const char*>(m);
+        assert(reinterpret_cast<const char*>(&m->value()) > base);
+        assert(reinterpret_cast<const char*>(&m->value()) < base + sizeof(Channel::Message));
+        Result<Reading, Fault>& copy = m->to_result();
+        assert(copy.is_ok() && copy.get_next() != nullptr);
+        assert(copy.get_next()->get_next()->error_if<Fault>() != nullptr);
+        delete &copy;
+        channel.release();
+        assert(channel.try_send(*err));
+        m = channel.try_receive();
+        assert(m != nullptr && m->is_err() && m->error() == Fault::overrange && m->trace_size() == 0);
+        // errors without what() render as their code
+        Result<Reading, Fault>& received = m->to_result();
+        ArraySink<16> text;
+        received.render(text);
+        assert(strcmp(text.c_str(), "1") == 0);
+        delete &received;
+        channel.release();
+        m = channel.try_receive();
+        assert(m != nullptr && m->is_err());
+        channel.release();
+        assert(channel.try_receive() == nullptr);
+        delete ok;
+        delete err;
+        delete &channel;
+        delete &created;
+        cout << "passed!" << endl;
+    }
+    static void processes() {
+        using namespace std;
+        cout << "ResultChannel between processes.. ";
+        const int messages = 100000;
+        string name = channel_name("processes");
+        Result<Channel*, int>& created = Channel::create(name.c_str(), 64);
+        Channel& receiver = *created.unwrap();
+        pid_t child = fork();
+        assert(child >= 0);
+        if (child == 0) {
+            Result<Channel*, int>& opened = Channel::open(name.c_str());
+            if (opened.is_err()) {
+                _exit(1);
+            }
+            Channel& sender = *opened.unwrap();
+            for (int i = 0; i < messages; i++) {
+                Result<Reading, Fault>* r = i % 7 == 0
+                    ? static_cast<Result<Reading, Fault>*>(new Err<Reading, Fault>(Fault::offline))
+                    : static_cast<Result<Reading, Fault>*>(new Ok<Reading, Fault>(Reading{i, i * 0.5}));
+                r->push_back(Reading{i, -1.0});
+                sender.send(*r);
+                delete r;
+            }
+            // the parent owns the segment, so skip the destructors and leave it alone
+            _exit(0);
+        }
+        for (int i = 0; i < messages; i++) {
+            const Channel::Message& m = receiver.receive();
+            if (i % 7 == 0) {
+                assert(m.is_err() && m.error() == Fault::offline);
+            } else {
+                assert(m.is_ok() && m.value().sensor == i && m.value().value == i * 0.5);
+            }
+            assert(m.trace_size() == 1 && m.trace(0).value_if()->sensor == i);
+            receiver.release();
+        }
+        int status = 0;
+        waitpid(child, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        delete &receiver;
+        delete &created;
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        create();
+        send();
+        processes();
+    }
+};
+
+int main() {
+    using namespace std;
+    cout << "beginning ResultChannel unit test: " << endl;
+    TestChannel::all();
+    cout << "All tests complete!" << endl;
+}
@@ -0,0 +1,212 @@
+#include <libexception.hpp>
+#include <libtrace.hpp>
+#include <iostream>
+#include <exception>
+#include <assert.h>
+#include <bits/stdc++.h>
+using namespace LibException;
+struct Located : public Exception {
+    LIBEXCEPTION_TYPE(Located, Exception)
+    Located(const char* l) : Exception("Located", l) {}
+};
+struct MoreLocated : public Located {
+    LIBEXCEPTION_TYPE(MoreLocated, Located)
+    MoreLocated(const char* l) : Located(l) {}
+};
+struct Undeclared : public Exception {
+    Undeclared() : Exception("Undeclared", "") {}
+};
+struct TestException {
+    static void constructor() {
+        using namespace std;
+        cout << "Exception::Exception(const char*).. ";
+        Exception e;
+        assert(strcmp(e.what(), "Exception") == 0);
+        assert(strcmp(e.where(), "") == 0);
+        Exception f("foo");
+        assert(strcmp(f.what(), "Exception in foo") == 0);
+        assert(strcmp(f.where(), "foo") == 0);
+        Located g("bar");
+        assert(strcmp(g.what(), "Located in bar") == 0);
+        cout << "passed!" << endl;
+    }
+    static void assignment() {
+        using namespace std;
+        cout << "Exception::operator=().. ";
+        Exception e("foo");
+        Exception f("bar");
+        e = f;
+        e = e;
+        assert(strcmp(e.where(), "bar") == 0);
+        Exception g(e);
+        assert(strcmp(g.where(), "bar") == 0);
+        cout << "passed!" << endl;
+    }
+    static void is() {
+        using namespace std;
+        cout << "Exception::is<E2>().. ";
+        Exception e;
+        Located l("foo");
+        MoreLocated m("bar");
+        Undeclared u;
+        const Exception& ref = m;
+        assert(e.is<Exception>() && !e.is<Located>());
+        assert(l.is<Exception>() && l.is<Located>() && !l.is<MoreLocated>());
+        assert(ref.is<Exception>() && ref.is<Located>() && ref.is<MoreLocated>());
+        assert(ref.type_id() == LibTypeId::type_id<MoreLocated>);
+        assert(u.is<Exception>() && u.type_id() == LibTypeId::type_id<Exception>);
+        assert(LibTypeId::type_id<Located> != LibTypeId::type_id<MoreLocated>);
+        cout << "passed!" << endl;
+    }
+    static void copy() {
+        using namespace std;
+        cout << "Exception::Exception(const Exception&).. ";
+        Located l("baz");
+        Exception e(l);
+        // copies share the strings of the Exception they were copied from
+        assert(e.what() == l.what());
+        assert(e.where() == l.where());
+        // separate Exceptions with equal messages share the interned strings
+        Located m("baz");
+        assert(m.where() == l.where());
+        assert(m.what() == l.what());
+        Exception f;
+        f = m;
+        assert(f.what() == m.what());
+        f = e;
+        assert(f.what() == l.what());
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        constructor();
+        assignment();
+        is();
+        copy();
+    }
+};
+struct TestIntern {
+    static void intern() {
+        using namespace std;
+        cout << "intern(const char*).. ";
+        string a = "interned";
+        string b = "interned";
+        assert(a.c_str() != b.c_str());
+        const char* i = LibException::intern(a.c_str());
+        assert(i == LibException::intern(b.c_str()));
+        assert(strcmp(i, "interned") == 0);
+        assert(LibException::intern("interned_", 8) == i);
+        assert(LibException::intern("other") != i);
+        string long_location(1000, 'x');
+        Exception e(long_location.c_str());
+        assert(strlen(e.what()) == strlen("Exception in ") + 1000);
+        assert(e.where() == Exception(long_location.c_str()).where());
+        assert(e.what() == Exception(long_location.c_str()).what());
+        cout << "passed!" << endl;
+    }
+    static void concurrent() {
+        using namespace std;
+        cout << "intern(const char*) from many threads.. ";
+        const int threads = 8;
+        vector<vector<const char*>> results(threads);
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&results, t] {
+                for (int i = 0; i < 2000; i++) {
+                    results[t].push_back(LibException::intern(("site" + to_string(i)).c_str()));
+                }
+            });
+        }
+        for (thread& w : workers) {
+            w.join();
+        }
+        for (int t = 1; t < threads; t++) {
+            assert(results[t] == results[0]);
+        }
+        cout << "passed!" << endl;
+    }
+    // fills the table, so it runs after every other test that interns
+    static void limit() {
+        using namespace std;
+        cout << "intern(const char*) past LIBEXCEPTION_INTERN_LIMIT.. ";
+        const char* kept = LibException::intern("kept");
+        for (int i = 0; i < LIBEXCEPTION_INTERN_LIMIT; i++) {
+            LibException::intern(("limit" + to_string(i)).c_str());
+        }
+        assert(LibException::intern("past the limit") == nullptr);
+        // strings interned before the table filled up are still found
+        assert(LibException::intern("kept") == kept);
+        // a location interned earlier whose joined message is new keeps the message in its own block
+        Exception k("kept");
+        assert(k.where() == kept);
+        assert(strcmp(k.what(), "Exception in kept") == 0);
+        assert(LibException::intern(k.what()) == nullptr);
+        // Exceptions keep their own copy of a location that could not be interned
+        string location = "also past the limit";
+        Exception e(location.c_str());
+        location.clear();
+        assert(strcmp(e.where(), "also past the limit") == 0);
+        assert(strcmp(e.what(), "Exception in also past the limit") == 0);
+        Exception copy(e);
+        assert(copy.where() == e.where() && copy.what() == e.what());
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        intern();
+        concurrent();
+        limit();
+    }
+};
+#ifdef LIBEXCEPTION_BACKTRACE
+// kept out of line so that it shows up as its own frame
+__attribute__((noinline)) Located make_located() {
+    return Located("make_located");
+}
+#endif
+struct TestBacktrace {
+    static void capture() {
+#ifdef LIBEXCEPTION_BACKTRACE
+        using namespace std;
+        cout << "Backtrace::capture().. ";
+        Located e = make_located();
+        assert(e.get_backtrace().size() > 0);
+        Exception copy(e);
+        assert(copy.get_backtrace().size() == e.get_backtrace().size());
+        for (unsigned i = 0; i < e.get_backtrace().size(); i++) {
+            assert(copy.get_backtrace()[i] == e.get_backtrace()[i]);
+        }
+        cout << "passed!" << endl;
+#endif
+    }
+    static void symbolize() {
+#ifdef LIBEXCEPTION_BACKTRACE
+        using namespace std;
+        cout << "Backtrace::symbolize().. ";
+        Located e = make_located();
+        const char* first = Backtrace::symbolize(e.get_backtrace()[0]);
+        const char* second = Backtrace::symbolize(e.get_backtrace()[0]);
+        assert(first != nullptr && strlen(first) > 0);
+        // repeated lookups are served from the cache
+        assert(first == second);
+        stringstream ss;
+        LibTrace::OstreamSink sink(ss);
+        e.get_backtrace().render(sink);
+        assert(ss.str().find("    at ") != string::npos);
+        cout << "passed!" << endl;
+#endif
+    }
+    static void all() {
+        capture();
+        symbolize();
+    }
+};
+
+int main() {
+    using namespace std;
+    cout << "beginning Exception unit test: " << endl;
+    TestException::all();
+    cout << "beginning intern unit test: " << endl;
+    TestIntern::all();
+    cout << "beginning Backtrace unit test: " << endl;
+    TestBacktrace::all();
+    cout << "All tests complete!" << endl;
+}
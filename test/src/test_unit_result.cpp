@@ -1,4 +1,9 @@
 #include <libresult.hpp>
+#include <libexception.hpp>
+#include <libviews.hpp>
+#include <libvalidated.hpp>
+#include <libtrace.hpp>
+#include <liberrorstats.hpp>
 #include <iostream>
 #include <exception>
 #include <assert.h>
@@ -6,130 +11,160 @@
 #include <limits>
 #include <cstdlib>
 #include <ctime>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
 using namespace LibResult;
+// a large value that counts its copies and opts into shared payloads
+struct Document {
+    static inline int copies = 0;
+    std::vector<int> words;
+    Document(std::vector<int> w) : words(std::move(w)) {}
+    Document(const Document& other) : words(other.words) {
+        copies++;
+    }
+    Document(Document&&) = default;
+    Document& operator=(const Document& other) {
+        words = other.words;
+        copies++;
+        return *this;
+    }
+    Document& operator=(Document&&) = default;
+};
+template<> struct LibResult::shared_payload<Document> : std::true_type {};
 struct TestOk {
     static void constructor() {
         using namespace std;
         cout << "Ok::Ok(T).. ";
-        try {
-            Ok<int, exception> a = Ok<int, exception>(0); 
-            Ok<int, exception>(INT_MIN);
-            Ok<int, exception>(INT_MAX);
-            srand(time(nullptr));
-            for (int i = 0; i < 1000; i++) {
-                Ok<int, exception> j = Ok<int, exception>(rand());
-                Ok<int, exception> k = Ok<int, exception>(-rand());
-            }
-            float f = numeric_limits<float>::infinity();
-            Ok<float, exception> ok_f = Ok<float, exception>(std::move(f));
-            ok_f = Ok<float, exception>(-f);
-            Ok<float, exception>(0.0);
-            for (int i = 0; i < 1000; i++) {
-                Ok<float, exception> j = Ok<float, exception>(rand());
-                Ok<float, exception> k = Ok<float, exception>(-rand());
-            }
-            Ok<double, exception>(0.0);
-            double d =  numeric_limits<double>::infinity();
-            Ok<double, exception> x = Ok<double, exception>(std::move(d));
-            Ok<double, exception> y = Ok<double, exception>(-d);
-            for (int i = 0; i < 1000; i++) {
-                Ok<double, exception> j = Ok<double, exception>(rand());
-                Ok<double, exception> k = Ok<double, exception>(-rand());
-            }
-            Ok<string, exception>("foo");
-            Ok<const char*, exception>("bar");
-            Ok<const char*, exception>();
-            Ok<char, exception>('a');
-            Ok<Ok<int, exception>, exception> ok_ok_i = Ok<Ok<int, exception>, exception>(Ok<int, exception>(5));
-        } catch (exception& e) {
-            cout << "failed!" << endl;
-            return;
+        Ok<int, exception> a = Ok<int, exception>(0); 
+        Ok<int, exception>(INT_MIN);
+        Ok<int, exception>(INT_MAX);
+        srand(time(nullptr));
+        for (int i = 0; i < 1000; i++) {
+            Ok<int, exception> j = Ok<int, exception>(rand());
+            Ok<int, exception> k = Ok<int, exception>(-rand());
+        }
+        float f = numeric_limits<float>::infinity();
+        Ok<float, exception> ok_f = Ok<float, exception>(std::move(f));
+        ok_f = Ok<float, exception>(-f);
+        Ok<float, exception>(0.0);
+        for (int i = 0; i < 1000; i++) {
+            Ok<float, exception> j = Ok<float, exception>(rand());
+            Ok<float, exception> k = Ok<float, exception>(-rand());
         }
+        Ok<double, exception>(0.0);
+        double d =  numeric_limits<double>::infinity();
+        Ok<double, exception> x = Ok<double, exception>(std::move(d));
+        Ok<double, exception> y = Ok<double, exception>(-d);
+        for (int i = 0; i < 1000; i++) {
+            Ok<double, exception> j = Ok<double, exception>(rand());
+            Ok<double, exception> k = Ok<double, exception>(-rand());
+        }
+        Ok<string, exception>("foo");
+        Ok<const char*, exception>("bar");
+        Ok<const char*, exception>();
+        Ok<char, exception>('a');
+        Ok<Ok<int, exception>, exception> ok_ok_i = Ok<Ok<int, exception>, exception>(Ok<int, exception>(5));
         cout << "passed!" << endl;
     }
     static void unwrap() {
         using namespace std;
         cout << "Ok::unwrap().. ";
-        try {
-            Result<int, exception>* foo = new Ok<int, exception>(1);
-            assert(foo->unwrap() == 1);
-            assert(foo->unwrap() == 1);
-            delete foo;
-            int i = Ok<int, exception>(7).unwrap();
-            assert(i == 7);
-            i = Ok<int, exception>(INT_MAX).unwrap();
-            assert(i == INT_MAX);
-            i = Ok<int, exception>(INT_MIN).unwrap();
-            assert(i == INT_MIN);
-            string s = Ok<string, exception>("foo").unwrap();
-            assert(s == "foo");
-        } catch (exception& e) {
-            cout << "failed! " << e.what() << endl;
-            return;
-        } cout << "passed!" << endl;
+        Result<int, exception>* foo = new Ok<int, exception>(1);
+        assert(foo->unwrap() == 1);
+        assert(foo->unwrap() == 1);
+        delete foo;
+        int i = Ok<int, exception>(7).unwrap();
+        assert(i == 7);
+        i = Ok<int, exception>(INT_MAX).unwrap();
+        assert(i == INT_MAX);
+        i = Ok<int, exception>(INT_MIN).unwrap();
+        assert(i == INT_MIN);
+        string s = Ok<string, exception>("foo").unwrap();
+        assert(s == "foo");
+        cout << "passed!" << endl;
     }
     static void expect() {
         using namespace std;
         cout << "Ok::expect(string).. ";
-        try {
-            Result<int, exception>* foo = new Ok<int, exception>(1);
-            assert(foo->expect("foo") == 1);
-            delete foo;
-        } catch (exception& e) {
-            cout << "failed! " << e.what() << endl;
-            return;
-        } cout << "passed!" << endl;
+        Result<int, exception>* foo = new Ok<int, exception>(1);
+        assert(foo->expect("foo") == 1);
+        delete foo;
+        cout << "passed!" << endl;
     }
     static void is_ok() {
         using namespace std;
         cout << "Ok::is_ok().. ";
-        try {
-            Result<int, exception>* foo = new Ok<int, exception>(1);
-            assert(foo->is_ok());
-            delete foo;
-        } catch (exception& e) {
-            cout << "failed! " << e.what() << endl;
-            return;
-        } cout << "passed!" << endl;
+        Result<int, exception>* foo = new Ok<int, exception>(1);
+        assert(foo->is_ok());
+        delete foo;
+        cout << "passed!" << endl;
     }
     static void is_err() {
         using namespace std;
-        try {
-            cout << "Ok::is_err().. ";
-            Result<int, exception>* foo = new Ok<int, exception>(1);
-            assert(!foo->is_err());
-            delete foo;
-        } catch (exception& e) {
-            cout << "failed! " << e.what() << endl;
-            return;
-        } cout << "passed!" << endl;
+        cout << "Ok::is_err().. ";
+        Result<int, exception>* foo = new Ok<int, exception>(1);
+        assert(!foo->is_err());
+        delete foo;
+        cout << "passed!" << endl;
     }
     static void assignment() {
         using namespace std;
         cout << "Ok::operator=().. ";
-        try {
-            Ok<int, exception> ok_i(3); // = Ok<int, exception>(3);
-            ok_i = Ok<int, exception>(5);
-            ok_i = Ok<int, exception>(0);
-            ok_i = Ok<int, exception>(-1);
-            ok_i = ok_i;
-            ok_i = Ok<int, exception>(INT_MAX);
-            ok_i = Ok<int, exception>(INT_MIN);
-            Ok<float, exception> ok_f(3); // = Ok<float, exception>(3.1);
-            ok_f = Ok<float, exception>(7.2);
-            ok_f = Ok<float, exception>(33.13);
-            ok_f = Ok<float, exception>(33.13);
-            ok_f = Ok<float, exception>(3.13);
-            ok_f = Ok<float, exception>(343.234);
-            ok_f = ok_f;
-            ok_f = Ok<float, exception>(0.0);
-            ok_f = Ok<float, exception>(-100.0);
-            ok_f = Ok<float, exception>(-1.00003);
-            ok_f = Ok<float, exception>(23423421.1);
-        } catch (exception& e) {
-            cout << "failed! " << e.what() << endl;
-            return;
-        } 
+        Ok<int, exception> ok_i(3); // = Ok<int, exception>(3);
+        ok_i = Ok<int, exception>(5);
+        ok_i = Ok<int, exception>(0);
+        ok_i = Ok<int, exception>(-1);
+        ok_i = ok_i;
+        ok_i = Ok<int, exception>(INT_MAX);
+        ok_i = Ok<int, exception>(INT_MIN);
+        Ok<float, exception> ok_f(3); // = Ok<float, exception>(3.1);
+        ok_f = Ok<float, exception>(7.2);
+        ok_f = Ok<float, exception>(33.13);
+        ok_f = Ok<float, exception>(33.13);
+        ok_f = Ok<float, exception>(3.13);
+        ok_f = Ok<float, exception>(343.234);
+        ok_f = ok_f;
+        ok_f = Ok<float, exception>(0.0);
+        ok_f = Ok<float, exception>(-100.0);
+        ok_f = Ok<float, exception>(-1.00003);
+        ok_f = Ok<float, exception>(23423421.1);
+        cout << "passed!" << endl;
+    }
+    static void shared() {
+        using namespace std;
+        cout << "Ok<shared_payload>.. ";
+        Ok<Document, exception>* original = new Ok<Document, exception>(Document(vector<int>(1000, 7)));
+        Document::copies = 0;
+        Ok<Document, exception>* copy = new Ok<Document, exception>(*original);
+        assert(copy->value_ptr() == original->value_ptr());
+        Result<Document, exception>* head = new Ok<Document, exception>(Document({1}));
+        head->push_back_copy(*original);
+        head->push_back_copy(*copy);
+        assert(head->get_next()->value_ptr() == original->value_ptr());
+        assert(Document::copies == 0);
+        // assigning to a shared T copies it and leaves the other Oks alone
+        *copy = Document({2});
+        assert(copy->value_ptr() != original->value_ptr());
+        assert(original->unwrap().words.size() == 1000);
+        assert(copy->unwrap().words == vector<int>({2}));
+        Document::copies = 0;
+        // once unshared, it is assigned in place
+        const void* before = copy->value_ptr();
+        *copy = Document({3});
+        assert(copy->value_ptr() == before && Document::copies == 1);
+        // taking a shared T copies it out first
+        Document taken = original->take();
+        assert(taken.words.size() == 1000 && Document::copies == 2);
+        assert(head->get_next()->value_if<Document>()->words.size() == 1000);
+        delete original;
+        delete copy;
+        assert(head->get_next()->get_next()->value_if<Document>()->words.size() == 1000);
+        delete head;
+        // payloads that did not opt in are still copied
+        Ok<string, exception> s("text");
+        Ok<string, exception> t(s);
+        assert(s.value_ptr() != t.value_ptr());
         cout << "passed!" << endl;
     }
     static void all() {
@@ -139,6 +174,7 @@ struct TestOk {
         is_ok();
         is_err();
         assignment();
+        shared();
     }
 };
 struct TestErr {
@@ -148,6 +184,7 @@ struct TestErr {
         Err<int, exception> e = exception();
         cout << "passed!" << endl;
     }
+#if LIBRESULT_EXCEPTIONS
     static void unwrap() {
         using namespace std;
         cout << "Err::unwrap().. ";
@@ -169,64 +206,897 @@ struct TestErr {
             cout << "failed!" << endl;
         } catch (exception& e) {}
     }
+#else
+    // runs f in a child process, which an unwrap handler ends with the exit status 3 if it is handed an Err
+    // with the given note, and returns the child's wait status
+    template<class F> static int unwrap_in_child(F f, bool handled) {
+        std::cout.flush();
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            if (handled) {
+                set_unwrap_handler([](const ResultBase& err, const char* note) {
+                    _exit(err.is_err() && (note == nullptr || strcmp(note, "expected") == 0) ? 3 : 1);
+                });
+            }
+            f();
+            _exit(0);
+        }
+        int status = 0;
+        waitpid(child, &status, 0);
+        return status;
+    }
+    static void unwrap() {
+        using namespace std;
+        cout << "Err::unwrap() without exceptions.. ";
+        Result<int, exception>* a = new Err<int, exception>(exception());
+        int status = unwrap_in_child([a] { a->unwrap(); }, true);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 3);
+        // the default handler aborts
+        status = unwrap_in_child([a] { a->unwrap(); }, false);
+        assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+        delete a;
+        cout << "passed!" << endl;
+    }
+    static void expect() {
+        using namespace std;
+        cout << "Err::expect(string) without exceptions.. ";
+        Err<int, exception> a = exception();
+        int status = unwrap_in_child([&a] { a.expect("expected"); }, true);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 3);
+        cout << "passed!" << endl;
+    }
+#endif
+    static void unwrap_or() {
+        using namespace std;
+        cout << "Result::unwrap_or(T).. ";
+        Result<int, exception>* a = new Err<int, exception>(exception());
+        Result<int, exception>* b = new Ok<int, exception>(4);
+        assert(a->unwrap_or(5) == 5 && b->unwrap_or(5) == 4);
+        delete a;
+        delete b;
+        cout << "passed!" << endl;
+    }
     static void is_ok() {
         using namespace std;
         cout << "Err::is_ok().. ";
         Err<int, exception> e = exception();
-        try {
-            assert(!e.is_ok());
-            assert(e.is_ok() == false);
-        } catch (exception& ee) {
-            cout << "failed!" << ee.what() << endl;
-        } cout << "passed!" << endl;
+        assert(!e.is_ok());
+        assert(e.is_ok() == false);
+        cout << "passed!" << endl;
     }
     static void is_err() {
         using namespace std;
         cout << "Err::is_err()..";
         Err<int, exception> e = exception();
-        try {
-            assert(e.is_err() == true);
-            assert(e.is_err());
-        } catch (exception& ee) {
-            cout << "failed! " << ee.what() << endl;
-        } cout << "passed!" << endl;
+        assert(e.is_err() == true);
+        assert(e.is_err());
+        cout << "passed!" << endl;
     }
     static void assignment() {
         using namespace std;
-        try {
-            cout << "Err::operator=().. ";
-            Err<int, exception> e = new exception();
-            e = new out_of_range("");
-            assert(strcmp(e.what(), out_of_range("").what()) == 0);
-            e = new logic_error("asdf");
-            assert(strcmp(e.what(), logic_error("asdf").what()) == 0);
-            e = e;
-            e = new length_error("exdgr");
-            assert(strcmp(e.what(), length_error("exdgr").what()) == 0);
-            e = new invalid_argument("");
-            assert(strcmp(e.what(), invalid_argument("").what()) == 0);
-            e = new domain_error("jklj");
-            assert(strcmp(e.what(), domain_error("jklj").what()) == 0);
-        } catch (exception& e) {
-            cout << "failed! " << e.what() << endl;
-        }
+        cout << "Err::operator=().. ";
+        Err<int, exception> e = new exception();
+        e = new out_of_range("");
+        assert(strcmp(e.what(), out_of_range("").what()) == 0);
+        e = new logic_error("asdf");
+        assert(strcmp(e.what(), logic_error("asdf").what()) == 0);
+        e = e;
+        e = new length_error("exdgr");
+        assert(strcmp(e.what(), length_error("exdgr").what()) == 0);
+        e = new invalid_argument("");
+        assert(strcmp(e.what(), invalid_argument("").what()) == 0);
+        e = new domain_error("jklj");
+        assert(strcmp(e.what(), domain_error("jklj").what()) == 0);
         cout << "passed!" << endl;
     }
     static void all() {
         constructor();
         unwrap();
         expect();
+        unwrap_or();
         is_ok();
         is_err();
         assignment();
     }
 };
 
+struct Negative : public LibException::Exception {
+    LIBEXCEPTION_TYPE(Negative, LibException::Exception)
+    Negative() : LibException::Exception("Negative", "") {}
+};
+struct VeryNegative : public Negative {
+    LIBEXCEPTION_TYPE(VeryNegative, Negative)
+};
+struct TestMatch {
+    static void match() {
+        using namespace std;
+        using LibException::Exception;
+        cout << "Err::match().. ";
+        Err<int, Exception> neg(new Negative());
+        Err<int, Exception> very(new VeryNegative());
+        Err<int, Exception> plain(new Exception("foo"));
+        auto which = [](const Err<int, Exception>& e) {
+            return e.match(
+                on<Negative>([](const Negative&) { return 1; }),
+                on<VeryNegative>([](const VeryNegative&) { return 2; }),
+                on<Exception>([](const Exception&) { return 3; })
+            );
+        };
+        assert(which(neg) == 1);
+        assert(which(very) == 2);
+        assert(which(plain) == 3);
+        // with no exact handler the first base handler is used, and R() if there is none
+        assert(very.match(on<Negative>([](const Negative&) { return 4; })) == 4);
+        assert(plain.match(on<Negative>([](const Negative&) { return 4; })) == 0);
+        cout << "passed!" << endl;
+    }
+    static void result_match() {
+        using namespace std;
+        using LibException::Exception;
+        cout << "Result::match().. ";
+        Result<int, Exception>* ok = new Ok<int, Exception>(5);
+        Result<int, Exception>* err = new Err<int, Exception>(new VeryNegative());
+        auto value = [](const Result<int, Exception>* r) {
+            return r->match(
+                [](const int& i) { return i; },
+                on<Negative>([](const Negative&) { return -1; })
+            );
+        };
+        assert(value(ok) == 5);
+        assert(value(err) == -1);
+        delete ok;
+        delete err;
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        match();
+        result_match();
+    }
+};
+struct TestStats {
+    static void snapshot() {
+        using namespace std;
+        using LibException::Exception;
+        cout << "ErrorStats::snapshot().. ";
+        ErrorStats::snapshot(true);
+        ErrorStats::enable();
+        vector<thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([] {
+                for (int i = 0; i < 1000; i++) {
+                    Err<int, Exception> a(new Negative());
+                    Err<int, Exception> b(new Exception("stats_site"));
+                    if (i % 2 == 0) {
+                        Err<int, Exception> c(new Exception("stats_site"));
+                    }
+                }
+            });
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+        // conversions and copies of a counted error are not counted again
+        Err<int, Exception>* err = new Err<int, Exception>(new Negative());
+        delete &err->into<float>();
+        ErrorStats::enable(false);
+        Err<int, Exception> ignored(new Negative());
+        vector<ErrorStats::Row> rows = ErrorStats::snapshot(true);
+        assert(rows.size() == 2);
+        assert(rows[0].location == "stats_site" && rows[0].count == 6000);
+        assert(rows[0].type == LibTypeId::type_id<Exception>);
+        assert(rows[0].description == "Exception in stats_site");
+        assert(rows[1].location == "" && rows[1].count == 4001);
+        assert(rows[1].type == LibTypeId::type_id<Negative>);
+        assert(ErrorStats::json(rows).find("\"location\":\"stats_site\",\"description\":\"Exception in stats_site\",\"count\":6000") != string::npos);
+        assert(ErrorStats::table(rows).find("Exception in stats_site") != string::npos);
+        rows = ErrorStats::snapshot();
+        assert(rows.size() == 2 && rows[0].count == 0 && rows[1].count == 0);
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        snapshot();
+    }
+};
+Result<int, std::exception>& try_same(Result<int, std::exception>& r) {
+    Result<int, std::exception>& a = LIBRESULT_TRY(r);
+    Result<int, std::exception>& b = *(new Ok<int, std::exception>(a.unwrap() + 1));
+    b.push_back(a);
+    return b;
+}
+Result<std::string, std::exception>& try_other(Result<int, std::exception>& r) {
+    Result<int, std::exception>& a = LIBRESULT_TRY(try_same(r));
+    Result<std::string, std::exception>& b = *(new Ok<std::string, std::exception>(std::to_string(a.unwrap())));
+    b.push_back(a);
+    return b;
+}
+struct TestSampler {
+    // a pipeline stage that records its input in the trace
+    static Result<int, std::exception>& stage(Result<int, std::exception>& a) {
+        Result<int, std::exception>& b = *(new Ok<int, std::exception>(a.unwrap() + 1));
+        b.push_back(a);
+        b.push_back(-1);
+        return b;
+    }
+    static int depth(const ResultBase& head) {
+        int frames = 0;
+        for (const ResultBase* f = &head; f != nullptr; f = f->get_next()) {
+            frames++;
+        }
+        return frames;
+    }
+    static void every() {
+        using namespace std;
+        cout << "Sampler::every().. ";
+        Sampler::every(4);
+        int sampled = 0;
+        for (int i = 0; i < 8; i++) {
+            bool decision = Sampler::begin();
+            assert(decision == Sampler::tracing());
+            Result<int, exception>& r = stage(stage(*(new Ok<int, exception>(0))));
+            assert(depth(r) == (decision ? 5 : 1));
+            sampled += decision;
+            delete &r;
+        }
+        assert(sampled == 2);
+        // each thread decides on its own
+        thread other([] {
+            assert(Sampler::begin());
+            assert(!Sampler::begin());
+        });
+        other.join();
+        Sampler::end();
+        assert(Sampler::tracing());
+        Sampler::all();
+        cout << "passed!" << endl;
+    }
+    static void per_second() {
+        using namespace std;
+        cout << "Sampler::per_second().. ";
+        Sampler::per_second(0, 2);
+        assert(Sampler::begin());
+        assert(Sampler::begin());
+        assert(!Sampler::begin());
+        Sampler::per_second(1e9, 1);
+        assert(Sampler::begin());
+        Sampler::end();
+        Sampler::all();
+        cout << "passed!" << endl;
+    }
+    static void force_errors() {
+        using namespace std;
+        cout << "Sampler::force_errors().. ";
+        Sampler::every(1000);
+        Sampler::force_errors(1);
+        assert(Sampler::begin());
+        assert(!Sampler::begin());
+        Result<int, exception>& a = stage(*(new Ok<int, exception>(0)));
+        assert(depth(a) == 1);
+        // the Err turns tracing on for the rest of the operation
+        Result<int, exception>& b = *(new Err<int, exception>(new logic_error("bad")));
+        assert(Sampler::tracing());
+        b.push_back(a);
+        assert(depth(b) == 2);
+        delete &b;
+        // changing the configuration starts every thread over
+        Sampler::force_errors(0);
+        assert(Sampler::begin());
+        assert(!Sampler::begin());
+        Result<int, exception>* c = new Err<int, exception>(new logic_error("bad"));
+        assert(!Sampler::tracing());
+        delete c;
+        Sampler::end();
+        Sampler::all();
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        every();
+        per_second();
+        force_errors();
+    }
+};
+struct TestTry {
+    static void ok() {
+        using namespace std;
+        cout << "LIBRESULT_TRY(Ok).. ";
+        Result<string, exception>& r = try_other(*(new Ok<int, exception>(1)));
+        assert(r.is_ok() && r.unwrap() == "2");
+        delete &r;
+        cout << "passed!" << endl;
+    }
+    static void err() {
+        using namespace std;
+        cout << "LIBRESULT_TRY(Err).. ";
+        Result<int, exception>& e = *(new Err<int, exception>(new logic_error("bad")));
+        Result<int, exception>& same = try_same(e);
+        // propagation within a type returns the Err itself
+        assert(&same == &e);
+        Err<int, exception>& same_err = static_cast<Err<int, exception>&>(same);
+        assert(same_err.site_count() == 1);
+        assert(strstr(same_err.get_site(0).function_name(), "try_same") != nullptr);
+        Result<string, exception>& other = try_other(same);
+        Err<string, exception>& other_err = static_cast<Err<string, exception>&>(other);
+        assert(strcmp(other_err.what(), "bad") == 0);
+        assert(other_err.site_count() == 3);
+        assert(strstr(other_err.get_site(2).function_name(), "try_other") != nullptr);
+        stringstream ss;
+        LibTrace::get_trace(other, ss);
+        assert(ss.str().find("propagated through") != string::npos);
+        delete &other;
+        cout << "passed!" << endl;
+    }
+    static void depth() {
+        using namespace std;
+        cout << "Err::add_site().. ";
+        // the sites are kept inside the Err, next to their count, so recording one never allocates
+        static_assert(sizeof(source_location) == sizeof(void*));
+        static_assert(sizeof(Err<int, exception>) <= sizeof(Result<int, exception>) + LIBRESULT_TRY_DEPTH * sizeof(source_location) + sizeof(void*));
+        Err<int, exception> e = exception();
+        assert(e.site_count() == 0 && e.propagation_count() == 0);
+        for (int i = 0; i < LIBRESULT_TRY_DEPTH + 3; i++) {
+            e.add_site(source_location::current());
+        }
+        assert(e.site_count() == LIBRESULT_TRY_DEPTH);
+        assert(e.propagation_count() == LIBRESULT_TRY_DEPTH + 3);
+        stringstream ss;
+        LibTrace::render(e, ss);
+        assert(ss.str().find("propagated 3 more times") != string::npos);
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        ok();
+        err();
+        depth();
+    }
+};
+// a pipeline stage in the style of the integration test
+Result<int, std::exception>& halve(Result<int, std::exception>& a) {
+    int i = a.unwrap();
+    Result<int, std::exception>& b = i % 2 == 0
+        ? static_cast<Result<int, std::exception>&>(*(new Ok<int, std::exception>(i / 2)))
+        : static_cast<Result<int, std::exception>&>(*(new Err<int, std::exception>(new std::domain_error("odd"))));
+    b.push_back(a);
+    return b;
+}
+Result<std::string, std::exception>& show(Result<int, std::exception>& a) {
+    Result<std::string, std::exception>& b = *(new Ok<std::string, std::exception>(std::to_string(a.unwrap())));
+    b.push_back(a);
+    return b;
+}
+struct TestViews {
+    static void and_then() {
+        using namespace std;
+        cout << "views::and_then().. ";
+        int pulled = 0;
+        auto source = std::views::iota(0, 10) | std::views::transform([&pulled](int i) -> Result<int, exception>* {
+            pulled++;
+            return new Ok<int, exception>(i == 5 ? 3 : i * 4);
+        });
+        vector<string> out;
+        bool saw_err = false;
+        for (Result<string, exception>* r : source | LibResult::views::and_then(halve) | LibResult::views::and_then(show)) {
+            if (r->is_err()) {
+                saw_err = true;
+                assert(strcmp(static_cast<Err<string, exception>*>(r)->what(), "odd") == 0);
+            } else {
+                out.push_back(r->unwrap());
+            }
+            delete r;
+        }
+        // the Err from element 5 ends the range without pulling element 6
+        assert(saw_err);
+        assert(pulled == 6);
+        assert((out == vector<string>{"0", "2", "4", "6", "8"}));
+        cout << "passed!" << endl;
+    }
+    static void keep_going() {
+        using namespace std;
+        cout << "views::and_then(keep_going).. ";
+        auto source = std::views::iota(0, 6) | std::views::transform([](int i) -> Result<int, exception>* {
+            return new Ok<int, exception>(i);
+        });
+        int oks = 0;
+        int errs = 0;
+        for (Result<int, exception>* r : source | LibResult::views::and_then(halve, LibResult::views::Mode::keep_going)) {
+            (r->is_ok() ? oks : errs)++;
+            delete r;
+        }
+        assert(oks == 3 && errs == 3);
+        cout << "passed!" << endl;
+    }
+    static void take_ok() {
+        using namespace std;
+        cout << "views::take_ok.. ";
+        // a million records stream through without being materialized
+        auto source = std::views::iota(0, 1000000) | std::views::transform([](int i) -> Result<long, exception>* {
+            return new Ok<long, exception>(i);
+        });
+        long sum = 0;
+        for (long v : source | LibResult::views::take_ok) {
+            sum += v;
+        }
+        assert(sum == 999999L * 1000000L / 2);
+        auto stopped = std::views::iota(0, 10) | std::views::transform([](int i) -> Result<int, exception>* {
+            return i == 3 ? static_cast<Result<int, exception>*>(new Err<int, exception>(new logic_error("three")))
+                          : static_cast<Result<int, exception>*>(new Ok<int, exception>(i));
+        }) | LibResult::views::take_ok;
+        int count = 0;
+        for (int v : stopped) {
+            assert(v == count);
+            count++;
+        }
+        assert(count == 3);
+        assert(stopped.error() != nullptr && stopped.error()->is_err());
+        cout << "passed!" << endl;
+    }
+    static void collect_result() {
+        using namespace std;
+        cout << "views::collect_result().. ";
+        auto source = std::views::iota(0, 4) | std::views::transform([](int i) -> Result<int, exception>* {
+            return new Ok<int, exception>(i * 2);
+        });
+        Result<vector<int>, exception>& all = source | LibResult::views::and_then(halve) | LibResult::views::collect_result();
+        assert(all.is_ok() && (all.unwrap() == vector<int>{0, 1, 2, 3}));
+        delete &all;
+        int pulled = 0;
+        auto odd = std::views::iota(0, 10) | std::views::transform([&pulled](int i) -> Result<int, exception>* {
+            pulled++;
+            return new Ok<int, exception>(i);
+        });
+        Result<vector<int>, exception>& failed = LibResult::views::collect_result(odd | LibResult::views::and_then(halve));
+        assert(failed.is_err() && pulled == 2);
+        // the Err keeps the trace of the element that failed
+        assert(failed.get_next() != nullptr && *failed.get_next()->value_if<int>() == 1);
+        delete &failed;
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        and_then();
+        keep_going();
+        take_ok();
+        collect_result();
+    }
+};
+// a value printed through its "<<" operation
+struct Point {
+    int x;
+    int y;
+};
+std::ostream& operator<<(std::ostream& os, const Point& p) {
+    return os << "(" << p.x << ", " << p.y << ")";
+}
+template<> struct LibResult::Formatter<Point> : LibTrace::StreamFormatter<Point> {};
+// a value printed through a Formatter without any "<<" operation
+struct Celsius {
+    double degrees;
+};
+template<> struct LibResult::Formatter<Celsius> {
+    static void format(TraceSink& sink, const Celsius& c) {
+        sink.write(c.degrees);
+        sink.write(" C");
+    }
+};
+// a value that cannot be printed
+struct Opaque {};
+enum class FieldError {
+    missing,
+    too_small,
+    too_large
+};
+struct TestValidated {
+    static Result<int, FieldError>& field(int v) {
+        if (v < 0) {
+            return *new Err<int, FieldError>(FieldError::too_small);
+        }
+        return *new Ok<int, FieldError>(v);
+    }
+    static void ensure() {
+        using namespace std;
+        cout << "Validated::ensure().. ";
+        Validated<int, FieldError> v(7);
+        v.reserve(3);
+        v.ensure(true, FieldError::missing).ensure(false, FieldError::too_small).ensure(false, FieldError::too_large);
+        assert(!v.is_valid() && v.error_count() == 2);
+        assert(v.get_errors()[0] == FieldError::too_small && v.get_errors()[1] == FieldError::too_large);
+        assert(v.get() == 7);
+        Result<int, FieldError>& r = v.into_result();
+        assert(r.is_err() && *r.error_if<FieldError>() == FieldError::too_small);
+        assert(r.get_next() != nullptr && *r.get_next()->error_if<FieldError>() == FieldError::too_large);
+        assert(r.get_next()->get_next() == nullptr);
+        delete &r;
+        Validated<int, FieldError> ok(3);
+        Result<int, FieldError>& o = ok.into_result();
+        assert(o.is_ok() && o.unwrap() == 3);
+        delete &o;
+        cout << "passed!" << endl;
+    }
+    static void check() {
+        using namespace std;
+        cout << "Validated::check().. ";
+        Validated<vector<int>, FieldError> v(vector<int>{});
+        for (int i : {1, -1, 2, -2}) {
+            if (optional<int> x = v.check(field(i))) {
+                v.get().push_back(*x);
+            }
+        }
+        assert(v.error_count() == 2 && v.get() == vector<int>({1, 2}));
+        // the trace of an absorbed Err is handed on
+        Result<int, FieldError>& traced = field(-3);
+        traced.push_back(-3);
+        v.check(traced);
+        Result<vector<int>, FieldError>& r = v.into_result();
+        vector<const ResultBase*> frames;
+        for (const ResultBase* f = &r; f != nullptr; f = f->get_next()) {
+            frames.push_back(f);
+        }
+        assert(frames.size() == 4);
+        assert(frames[1]->is_err() && frames[2]->is_err());
+        assert(*frames[3]->value_if<int>() == -3);
+        delete &r;
+        cout << "passed!" << endl;
+    }
+    static void zip() {
+        using namespace std;
+        cout << "zip().. ";
+        Validated<tuple<int, int, string>, FieldError> all = LibResult::zip(field(1), field(2), Validated<string, FieldError>("x"));
+        assert(all.is_valid() && all.get() == make_tuple(1, 2, string("x")));
+        Validated<int, FieldError> sum = zip_with([](int a, int b, int c) {
+            return a + b + c;
+        }, field(-1), Validated<int, FieldError>::invalid(FieldError::missing), field(-2));
+        assert(sum.error_count() == 3);
+        assert(sum.get_errors() == vector<FieldError>({FieldError::too_small, FieldError::missing, FieldError::too_small}));
+        Validated<int, FieldError> three = zip_with([](int a, int b) {
+            return a + b;
+        }, field(1), field(2));
+        assert(three.is_valid() && three.get() == 3);
+        cout << "passed!" << endl;
+    }
+    static void into_result() {
+        using namespace std;
+        using LibException::Exception;
+        cout << "Validated::into_result() counts and keeps each error once.. ";
+        ErrorStats::snapshot(true);
+        ErrorStats::enable();
+        Sampler::every(1000);
+        assert(Sampler::begin());
+        assert(!Sampler::begin());
+        Validated<int, Exception> v(1);
+        v.ensure(false, Exception("validated_a")).ensure(false, Exception("validated_b"));
+        v.check(*new Err<int, Exception>(new Exception("validated_c")));
+        assert(!Sampler::tracing());
+        Result<int, Exception>& r = v.into_result();
+        ErrorStats::enable(false);
+        Sampler::end();
+        Sampler::all();
+        // the frames are the result, so they are kept although the operation is not sampled
+        vector<string> where;
+        for (const ResultBase* f = &r; f != nullptr; f = f->get_next()) {
+            where.push_back(f->error_if<Exception>()->where());
+        }
+        assert((where == vector<string>{"validated_a", "validated_b", "validated_c"}));
+        delete &r;
+        vector<ErrorStats::Row> rows = ErrorStats::snapshot(true);
+        // sites counted by earlier tests stay in the table with a count of 0
+        int sites = 0;
+        for (const ErrorStats::Row& row : rows) {
+            if (row.location.rfind("validated_", 0) == 0) {
+                assert(row.count == 1);
+                sites++;
+            }
+        }
+        assert(sites == 3);
+        cout << "passed!" << endl;
+    }
+    static void all() {
+        ensure();
+        check();
+        zip();
+        into_result();
+    }
+};
+struct TestTrace {
+    static void get_trace() {
+        using namespace std;
+        cout << "LibTrace::get_trace(ResultBase&, ostream&).. ";
+        Result<int, exception>* head = new Ok<int, exception>(3);
+        head->push_back(2);
+        head->push_back(1);
+        stringstream ss;
+        LibTrace::get_trace(*head, ss);
+        string line;
+        vector<string> lines;
+        while (getline(ss, line)) {
+            lines.push_back(line);
+        }
+        assert(lines.size() == 3);
+        assert(lines[0].rfind("3", 0) == 0);
+        assert(lines[1].rfind("2", 0) == 0);
+        assert(lines[2] == "1");
+        delete head;
+        cout << "passed!" << endl;
+    }
+    // renders one frame alone, since traces carry deltas when LIBRESULT_TIMESTAMPS is defined
+    template<class T> static std::string rendered(const T& t) {
+        Ok<T, std::exception> frame(t);
+        std::stringstream ss;
+        LibTrace::render(frame, ss);
+        return ss.str();
+    }
+    static void formatter() {
+        using namespace std;
+        cout << "Formatter<T>.. ";
+        assert(rendered(Point{1, 2}) == "(1, 2)");
+        assert(rendered(Celsius{21.5}) == "21.5 C");
+        assert(rendered(Opaque{}) == "<unprintable>");
+        assert(rendered('c') == "c");
+        assert(rendered(-7) == "-7");
+        assert(rendered(7u) == "7");
+        assert(rendered(0.25) == "0.25");
+        assert(rendered(string("text")) == "text");
+        cout << "passed!" << endl;
+    }
+    static void numbers() {
+        using namespace std;
+        cout << "TraceSink::write(number).. ";
+        // numbers are written as std::ostream writes them by default
+        vector<double> doubles = {0, -0.0, 1, 0.1, 2.302585, 1.0 / 3, 123456, 1234567, 1e-5, 1e-4, 6.02e23,
+            -1.5e-300, numeric_limits<double>::infinity(), numeric_limits<double>::max()};
+        for (double d : doubles) {
+            ostringstream expected;
+            expected << d;
+            assert(rendered(d) == expected.str());
+            expected.str("");
+            expected << static_cast<float>(d);
+            assert(rendered(static_cast<float>(d)) == expected.str());
+        }
+        assert(rendered(numeric_limits<long long>::min()) == to_string(numeric_limits<long long>::min()));
+        assert(rendered(numeric_limits<unsigned long long>::max()) == to_string(numeric_limits<unsigned long long>::max()));
+        cout << "passed!" << endl;
+    }
+    static void thread_buffer() {
+        using namespace std;
+        cout << "ThreadBufferSink.. ";
+        ThreadBufferSink outer;
+        outer.write("outer ");
+        {
+            ThreadBufferSink inner;
+            inner.write(42ll);
+            assert(string(inner.data(), inner.size()) == "42");
+        }
+        outer.write(0.5);
+        assert(string(outer.data(), outer.size()) == "outer 0.5");
+        cout << "passed!" << endl;
+    }
+    static void heterogeneous() {
+        using namespace std;
+        cout << "Result::push_back(ResultBase&).. ";
+        Result<string, exception>* text = new Ok<string, exception>("7");
+        Result<int, exception>* head = new Ok<int, exception>(7);
+        head->push_back(*text);
+        const ResultBase* frame = head->get_next();
+        assert(frame == text);
+        assert(frame->value_if<string>() != nullptr);
+        assert(*frame->value_if<string>() == "7");
+        assert(frame->value_if<int>() == nullptr);
+        assert(frame->error_if<exception>() == nullptr);
+        stringstream ss;
+        LibTrace::get_trace(*head, ss);
+        assert(ss.str().rfind("7", 0) == 0);
+        assert(ss.str().size() >= 4 && ss.str().substr(ss.str().size() - 3) == "\n7\n");
+        delete head;
+        cout << "passed!" << endl;
+    }
+    static void push_onto_linked() {
+        using namespace std;
+        cout << "Result::push_back() onto a linked frame.. ";
+        Result<string, exception>* a = new Ok<string, exception>("a");
+        Result<string, exception>* b = new Ok<string, exception>("b");
+        b->push_back(*a);
+        // frames pushed onto a go after the last frame of b's trace, and b's pushes go after them
+        a->push_back(string("x"));
+        b->push_back(string("y"));
+        a->push_back(*new Ok<string, exception>("z"));
+        b->push_back(string("w"));
+        vector<string> order;
+        for (const ResultBase* f = b; f != nullptr; f = f->get_next()) {
+            order.push_back(*f->value_if<string>());
+        }
+        assert((order == vector<string>{"b", "a", "x", "y", "z", "w"}));
+        delete b;
+        cout << "passed!" << endl;
+    }
+    static void into() {
+        using namespace std;
+        cout << "Err::into<T2>().. ";
+        Err<string, exception>* err = new Err<string, exception>(new logic_error("bad"));
+        err->push_back(string("input"));
+        err->push_back(string("more"));
+        Err<int, exception>& converted = err->into<int>();
+        assert(converted.is_err());
+        assert(strcmp(converted.what(), "bad") == 0);
+        const ResultBase* frame = converted.get_next();
+        assert(frame != nullptr && *frame->value_if<string>() == "input");
+        frame = frame->get_next();
+        assert(frame != nullptr && *frame->value_if<string>() == "more");
+        assert(frame->get_next() == nullptr);
+        Result<float, exception>* head = new Ok<float, exception>(1.0);
+        head->take_trace(converted);
+        assert(converted.get_next() == nullptr);
+        assert(head->get_next() != nullptr && *head->get_next()->value_if<string>() == "input");
+        delete head;
+        delete &converted;
+        cout << "passed!" << endl;
+    }
+    static void concurrent() {
+        using namespace std;
+        cout << "Result::push_back_concurrent().. ";
+        const int threads = 8;
+        const int appends = 20000;
+        Result<int, exception>* head = new Ok<int, exception>(-1);
+        head->begin_concurrent();
+        vector<thread> producers;
+        for (int t = 0; t < threads; t++) {
+            producers.emplace_back([head, t, appends] {
+                for (int i = 0; i < appends; i++) {
+                    // each append carries a trace of its own, which must stay contiguous
+                    Result<int, exception>* r = new Ok<int, exception>(t * appends + i);
+                    r->push_back(t * appends + i);
+                    head->push_back_concurrent(*r);
+                }
+            });
+        }
+        for (thread& p : producers) {
+            p.join();
+        }
+        vector<int> last(threads, -1);
+        int frames = 0;
+        for (const ResultBase* f = head->get_next(); f != nullptr; f = f->get_next()) {
+            int v = *f->value_if<int>();
+            const ResultBase* pair = f->get_next();
+            assert(pair != nullptr && *pair->value_if<int>() == v);
+            f = pair;
+            int t = v / appends;
+            assert(v > last[t]);
+            last[t] = v;
+            frames += 2;
+        }
+        assert(frames == threads * appends * 2);
+        // the tail is consistent again once the producers are done
+        head->push_back(7);
+        delete head;
+        // an appended Result whose tail went stale when a frame was pushed onto a Result linked into it
+        head = new Ok<int, exception>(0);
+        head->begin_concurrent();
+        Result<int, exception>* r = new Ok<int, exception>(1);
+        Result<int, exception>* s = new Ok<int, exception>(2);
+        r->push_back(*s);
+        s->push_back(*new Ok<int, exception>(3));
+        head->push_back_concurrent(*r);
+        head->push_back_concurrent(*new Ok<int, exception>(4));
+        assert((values(*head) == vector<int>{0, 1, 2, 3, 4}));
+        delete head;
+        // a head whose tail went stale the same way before the producers started
+        head = new Ok<int, exception>(0);
+        s = new Ok<int, exception>(1);
+        head->push_back(*s);
+        s->push_back(2);
+        head->begin_concurrent();
+        head->push_back_concurrent(*new Ok<int, exception>(3));
+        assert((values(*head) == vector<int>{0, 1, 2, 3}));
+        delete head;
+        cout << "passed!" << endl;
+    }
+    // the int values of a trace, in order
+    static std::vector<int> values(const ResultBase& head) {
+        std::vector<int> out;
+        for (const ResultBase* f = &head; f != nullptr; f = f->get_next()) {
+            out.push_back(*f->value_if<int>());
+        }
+        return out;
+    }
+    // true if frame lives inside the storage of head
+    template<class R> static bool inside(const R* head, const ResultBase* frame) {
+        uintptr_t begin = reinterpret_cast<uintptr_t>(head);
+        uintptr_t at = reinterpret_cast<uintptr_t>(frame);
+        return at >= begin && at < begin + sizeof(R);
+    }
+    static void inline_frames() {
+        using namespace std;
+        cout << "Result::push_back(T) inline frames.. ";
+        Ok<string, exception>* head = new Ok<string, exception>("head");
+        for (int i = 0; i < LIBRESULT_INLINE_FRAMES + 2; i++) {
+            head->push_back(to_string(i));
+        }
+        int i = 0;
+        for (const ResultBase* f = head->get_next(); f != nullptr; f = f->get_next(), i++) {
+            assert(*f->value_if<string>() == to_string(i));
+            assert(inside(head, f) == (i < LIBRESULT_INLINE_FRAMES));
+        }
+        assert(i == LIBRESULT_INLINE_FRAMES + 2);
+        // once another trace has been linked, frames are allocated to keep the order
+        Ok<string, exception>* mixed = new Ok<string, exception>("mixed");
+        mixed->push_back(string("a"));
+        mixed->push_back(*head);
+        mixed->push_back(string("b"));
+        const ResultBase* last = mixed;
+        while (last->get_next() != nullptr) {
+            last = last->get_next();
+        }
+        assert(*last->value_if<string>() == "b" && !inside(mixed, last));
+        assert(inside(mixed, mixed->get_next()) == (LIBRESULT_INLINE_FRAMES > 0));
+        // errors are kept inline too, and take_trace() moves inline frames out before the head goes
+        Err<int, exception>* err = new Err<int, exception>(new logic_error("bad"));
+        err->push_back(exception());
+        err->push_back(1);
+        assert(err->get_next()->is_err() && inside(err, err->get_next()) == (LIBRESULT_INLINE_FRAMES > 0));
+        Result<float, exception>* other = new Ok<float, exception>(1.0);
+        other->take_trace(*err);
+        delete err;
+        const ResultBase* moved = other->get_next();
+        assert(moved->is_err() && moved->error_if<exception>() != nullptr);
+        assert(*moved->get_next()->value_if<int>() == 1);
+        other->push_back(2.0f);
+        assert(*moved->get_next()->get_next()->value_if<float>() == 2.0f);
+        delete other;
+        delete mixed;
+        cout << "passed!" << endl;
+    }
+    static void timestamps() {
+#ifdef LIBRESULT_TIMESTAMPS
+        using namespace std;
+        cout << "Result::get_delta().. ";
+        Result<int, exception>* tail = new Ok<int, exception>(1);
+        Result<int, exception>* head = new Ok<int, exception>(2);
+        head->push_back(*tail);
+        assert(head->get_stamp() >= tail->get_stamp());
+        assert(head->get_delta() >= 0);
+        assert(tail->get_delta() == 0);
+        delete head;
+        // a value frame is built after its head, so its delta is negative and printed with a minus sign
+        head = new Ok<int, exception>(1);
+        head->push_back(2);
+        assert(head->get_delta() <= 0);
+        stringstream ss;
+        LibTrace::get_trace(*head, ss);
+        assert(ss.str().find("[+-") == string::npos);
+        assert(ss.str().find(head->get_delta() < 0 ? " [-" : " [+0 ns]") != string::npos);
+        delete head;
+        cout << "passed!" << endl;
+#endif
+    }
+    static void all() {
+        get_trace();
+        formatter();
+        numbers();
+        thread_buffer();
+        heterogeneous();
+        push_onto_linked();
+        into();
+        concurrent();
+        inline_frames();
+        timestamps();
+    }
+};
+
 int main() {
     using namespace std;
     cout << "beginning Ok unit test: " << endl;
     TestOk::all();
     cout << "beginning Err unit test: " << endl;
     TestErr::all();
+    cout << "beginning match unit test: " << endl;
+    TestMatch::all();
+    cout << "beginning stats unit test: " << endl;
+    TestStats::all();
+    cout << "beginning sampler unit test: " << endl;
+    TestSampler::all();
+    cout << "beginning try unit test: " << endl;
+    TestTry::all();
+    cout << "beginning views unit test: " << endl;
+    TestViews::all();
+    cout << "beginning validated unit test: " << endl;
+    TestValidated::all();
+    cout << "beginning trace unit test: " << endl;
+    TestTrace::all();
     cout << "All tests complete!" << endl;
 }